@@ -0,0 +1,740 @@
+//
+//  app.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 01/10/2023.
+//
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "app.h"
+#include "utils.h"
+#include "preset.h"
+
+#include "noalloc.h"
+
+// a tempo tick is a sequencer_clock() call
+_Static_assert(DEFAULT_PPQN == SEQUENCER_CLOCK_PPQN, "tempo and sequencer ppqn");
+
+#define DEBUG						0
+
+#define DEFAUTL_MIDI_IN_CHANNEL     1
+#define DEFAUTL_MIDI_OUT_CHANNEL    2
+
+#define CLOCK_IN_PIN                2
+#define CLOCK_OUT_PIN               3
+#define RESET_PIN                   4
+#define DIR_PIN    		            5
+
+// PINS DEFINITIONS
+const uint8_t              	outputs[N_TRIGGERS] = {
+	30,31,32,33,
+	34,35,36,37
+};
+
+// MIDI
+uint8_t                     midi_mapping_offset = 0;                        //ROM
+uint8_t                     midi_out_channel = DEFAUTL_MIDI_OUT_CHANNEL;     //ROM
+uint8_t                     midi_in_channel = DEFAUTL_MIDI_IN_CHANNEL;     //ROM
+
+EditQuantize				edit_quantize = kEditQuantize_None;				//ROM
+SwapQuantize				bank_quantize = kSwapQuantize_Bar;				//ROM
+
+// sequencer, renderer, dispatcher and Launchpad callbacks: ctx is the app_instance_t
+void wrap_sq_updateTriggers(void * ctx);
+void wrap_sq_updateTrigger(void * ctx, uint8_t triggerIndex);
+void wrap_sq_updateMutedTriggers(void * ctx, uint8_t triggerIndex);
+void wrap_sq_updatePattern(void * ctx, uint8_t sequenceIndex, uint8_t pI);
+void wrap_sq_updateStep(void * ctx, uint8_t sequenceIndex, uint8_t pI, uint8_t sI);
+void wrap_sq_updatePlayhead(void * ctx, uint8_t sequenceIndex, uint8_t pI, uint8_t prevSI, uint8_t sI);
+void wrap_sq_updateState(void * ctx);
+void wrap_sq_updateSequenceIndex(void * ctx, uint8_t sequenceIndex);
+void wrap_sq_updateNextSequenceIndex(void * ctx);
+
+void wrap_rd_drawStep(void * ctx, uint8_t sequenceIndex, uint8_t pI, uint8_t sI);
+void wrap_rd_drawPattern(void * ctx, uint8_t sequenceIndex, uint8_t pI);
+void wrap_rd_drawTriggers(void * ctx);
+void wrap_rd_drawState(void * ctx);
+void wrap_rd_followSequence(void * ctx, uint8_t sequenceIndex);
+void wrap_rd_input(void * ctx, SLMIDIPacket * packet, uint64_t time_ns);
+void wrap_rd_flush(void * ctx);
+
+bool processFunButton(app_instance_t * in, SLMIDIPacket *packet);
+bool processColButton(app_instance_t * in, SLMIDIPacket *packet);
+bool processGridButton(app_instance_t * in, SLMIDIPacket *packet);
+void clockInterruptCallback(app_instance_t * in);
+void wrap_sc_dispatch(void * ctx, uint8_t triggerIndex, uint8_t value);
+
+// shared clock callbacks: ctx is the app_t
+void wrap_tempo_tick(void * ctx);
+void wrap_tempo_idle(void * ctx);
+void wrap_mc_start(void * ctx);
+void wrap_mc_continue(void * ctx);
+void wrap_mc_stop(void * ctx);
+void wrap_mc_position(void * ctx, uint16_t sixteenths);
+void resetInterruptCallback(app_instance_t * in);
+
+void endTriggerOutput(app_instance_t * in, size_t outputIndex);
+void updateOutput(app_instance_t * in, size_t outputIndex, uint8_t value);
+void updateDisplay(app_instance_t * in);
+
+step_sequence_t * getCurrentSequenceSQ(app_instance_t * in);
+
+// -----------------------------------------------------------------
+
+/*
+*       The sequencer is only written by the clock (and by the host before it starts): its observers
+*       never draw, they publish to the renderer, the only thread writing the Launchpad
+*/
+
+void wrap_sq_updateMutedTriggers(void * ctx, uint8_t triggerIndex) {
+	// row, fn buttons and out column
+	updateDisplay((app_instance_t *)ctx);
+}
+
+void wrap_sq_updatePattern(void * ctx, uint8_t sequenceIndex, uint8_t pI) {
+	render_push(&((app_instance_t *)ctx)->renderer, kRenderEvent_Pattern, sequenceIndex, pI, 0, 0);
+}
+
+void wrap_sq_updateStep(void * ctx, uint8_t sequenceIndex, uint8_t pI, uint8_t stepIndex) {
+	render_push(&((app_instance_t *)ctx)->renderer, kRenderEvent_Step, sequenceIndex, pI, stepIndex, 0);
+}
+
+void wrap_sq_updatePlayhead(void * ctx, uint8_t sequenceIndex, uint8_t pI, uint8_t prevStepIndex, uint8_t stepIndex) {
+	render_push(&((app_instance_t *)ctx)->renderer, kRenderEvent_Playhead, sequenceIndex, pI, stepIndex, prevStepIndex);
+}
+
+void updateDisplay(app_instance_t * in) {
+	render_push(&in->renderer, kRenderEvent_State, 0, 0, 0, 0);
+}
+
+void wrap_sq_updateState(void * ctx) {
+	app_instance_t * in = (app_instance_t *)ctx;
+	app_t * a = in->app;
+	
+	updateDisplay(in);
+	
+	// the first instance's transport drives the clock output
+	if (in->index == 0 && in->sequencer.current_state != a->clock_out_state) {
+		if (in->sequencer.current_state == kSequencerState_Playing) {
+			midiclock_masterStart(&a->clock_out);
+		} else if (in->sequencer.current_state == kSequencerState_Stopped) {
+			midiclock_masterStop(&a->clock_out);
+		}
+		a->clock_out_state = in->sequencer.current_state;
+	}
+}
+
+void wrap_sq_updateTriggers(void * ctx) {
+	render_push(&((app_instance_t *)ctx)->renderer, kRenderEvent_Triggers, 0, 0, 0, 0);
+}
+
+void wrap_sq_updateTrigger(void * ctx, uint8_t triggerIndex) {
+	app_instance_t * in = (app_instance_t *)ctx;
+	
+	// output by the dispatcher, on time: where it falls between this tick and the next
+	const uint64_t offset = sequencer_eventOffset(&in->sequencer);
+	const uint64_t offsetNs = offset > 0 ? (uint64_t)(offset * in->app->internal_clock.period_ns / sequencer_ticksPerClock(&in->sequencer)) : 0;
+	scheduler_pushAt(&in->trigger_scheduler, triggerIndex, in->sequencer.triggers[triggerIndex], offsetNs);
+}
+
+void wrap_sq_updateSequenceIndex(void * ctx, uint8_t sequenceIndex) {
+	// followed by the view on the render thread
+	render_push(&((app_instance_t *)ctx)->renderer, kRenderEvent_Sequence, sequenceIndex, 0, 0, 0);
+}
+
+void wrap_sq_updateNextSequenceIndex(void * ctx) {
+	updateDisplay((app_instance_t *)ctx);
+}
+
+// --- Renderer thread ---
+
+void wrap_rd_drawStep(void * ctx, uint8_t sequenceIndex, uint8_t pI, uint8_t stepIndex) {
+	app_instance_t * in = (app_instance_t *)ctx;
+	
+	if (in->ls.current_view_mode == kLaunchpadViewMode_Lanes) {
+		// a column per step
+		if (in->ls.current_sequence_index == sequenceIndex && pI == in->ls.trigger_index) {
+			ls_updateColumn(&in->ls, stepIndex % LS_MAX_STEPS_PER_ROW);
+		}
+	} else if (in->ls.sequence_view_mode == kLaunchpadSequenceViewMode_Paginated) {
+		if (in->ls.current_sequence_index == sequenceIndex) {
+			ls_updateCell(&in->ls, stepIndex % LS_MAX_STEPS_PER_ROW, pI);
+		}
+	} else if (in->ls.sequence_view_mode == kLaunchpadSequenceViewMode_Grid) {
+		if (in->ls.current_sequence_index == sequenceIndex && pI == in->ls.trigger_index) {
+			ls_updateCell(&in->ls, stepIndex % LS_MAX_STEPS_PER_ROW, stepIndex / LS_MAX_STEPS_PER_ROW);
+		}
+	}
+}
+
+void wrap_rd_drawPattern(void * ctx, uint8_t sequenceIndex, uint8_t pI) {
+	app_instance_t * in = (app_instance_t *)ctx;
+	
+	if (in->ls.current_sequence_index == sequenceIndex) {
+		if (in->ls.sequence_view_mode == kLaunchpadSequenceViewMode_Paginated && in->ls.current_view_mode != kLaunchpadViewMode_Lanes) {
+			ls_updateRow(&in->ls, pI);
+		} else {
+			ls_updateGrid(&in->ls);
+		}
+	}
+}
+
+void wrap_rd_drawTriggers(void * ctx) {
+	ls_updateOutColumn(&((app_instance_t *)ctx)->ls);
+}
+
+void wrap_rd_drawState(void * ctx) {
+	app_instance_t * in = (app_instance_t *)ctx;
+	
+	// first frame: MK1 until the device tells otherwise
+	if (!in->version_requested) {
+		in->version_requested = true;
+		ls_requestVersion(&in->ls);
+	}
+	ls_updateDisplay(&in->ls);
+}
+
+void wrap_rd_followSequence(void * ctx, uint8_t sequenceIndex) {
+	app_instance_t * in = (app_instance_t *)ctx;
+	
+	if (in->ls.auto_follow_sequence) {
+		in->ls.current_sequence_index = sequenceIndex;
+	}
+}
+
+void wrap_rd_flush(void * ctx) {
+	ls_flush(&((app_instance_t *)ctx)->ls);
+}
+
+// MIDI thread: nothing but the clock PLL and the handover to the renderer
+void wrap_ls_midi_rcv(void * ctx, SLMIDIPacket * packet) {
+	app_instance_t * in = (app_instance_t *)ctx;
+	app_t * a = in->app;
+	
+	if (packet == NULL) {
+		return;
+	}
+	
+	// MIDI clock from the DAW: feeds the PLL, the internal clock does the stepping
+	const uint64_t now = packet->timestamp != 0 ? tempo_hostTimeToNs(packet->timestamp) : tempo_now();
+	if (midiclock_process(&a->external_clock, packet, now)) {
+		return;
+	}
+	
+	// a press is echoed by the frame handling it
+	if (packet->length >= 3 && packet->data[2] > 0) {
+		render_markOrigin(&in->renderer, kRenderOrigin_Input, now);
+	}
+	render_pushInput(&in->renderer, packet, now);
+}
+
+void wrap_rd_input(void * ctx, SLMIDIPacket * packet, uint64_t time_ns) {
+	app_instance_t * in = (app_instance_t *)ctx;
+	app_t * a = in->app;
+	
+	if (packet->length > 0 && packet->data[0] == kSLMIDIMessageType_System) {
+		// device inquiry reply, redraw with the right renderer. No SysEx is a button
+		if (ls_processSysex(&in->ls, packet)) {
+			ls_updateDisplay(&in->ls);
+		}
+		return;
+	}
+	
+	ls_translateInput(&in->ls, packet);
+	trace_write(&a->trace, kTraceEvent_Input, packet->data[0], packet->length > 1 ? packet->data[1] : 0, packet->length > 2 ? packet->data[2] : 0, 0);
+	
+	if (packet->length >= 3) {
+		//--------
+		if (!processFunButton(in, packet) && !processColButton(in, packet)) {
+			processGridButton(in, packet);
+		}
+		// the LEDs this event changed go with the frame, edits once the clock applied them
+#if DEBUG
+		if (ls_btnIsDown(packet)) {
+			printf("-----------------\n");
+			printf("SHIFT: %d\n", in->ls.shift_btn_hold);
+			printf("PAGE IDX: %d\n", in->ls.page_index);
+			printf("RECV: len: %d \t%02X %02X %02X\n",
+				   packet->length,
+				   packet->data[0],
+				   packet->data[1],
+				   packet->data[2]);
+		}
+#endif
+	}
+}
+
+// -----------------------------------------------------------------
+
+bool processFunButton(app_instance_t * in, SLMIDIPacket *packet) {
+	bool result = true;
+	
+	if (ls_btnMapValue(packet) == LS_BT_SHIFT) {
+		in->ls.shift_btn_hold = ls_btnIsDown(packet);
+		ls_setExtButton(&in->ls, LS_BT_SHIFT, ls_btnIsDown(packet) ? LS_COLOR_YELLOW : LS_COLOR_NONE);
+	} else if (ls_btnMapValue(packet) == LS_BT_CLEAR) {
+		
+		in->ls.clear_btn_hold = ls_btnIsDown(packet);
+		ls_setExtButton(&in->ls, LS_BT_CLEAR, ls_btnIsDown(packet) ? LS_COLOR_RED : LS_COLOR_NONE);
+		
+		if (in->ls.shift_btn_hold && in->ls.clear_btn_hold) {
+			edits_push(&in->edits, 0, kEditCommand_ClearAllPatterns, in->ls.current_sequence_index, 0, 0);
+		}
+	} else if ((ls_btnMapValue(packet) == LS_BT_UP_ARROW || ls_btnMapValue(packet) == LS_BT_DOWN_ARROW) && ls_btnIsDown(packet) && in->ls.current_view_mode == kLaunchpadViewMode_Lanes) {
+		ls_incrLaneIndex(&in->ls, ls_btnMapValue(packet) == LS_BT_UP_ARROW ? -1 : 1);
+	} else if (ls_btnMapValue(packet) == LS_BT_UP_ARROW && ls_btnIsDown(packet)) {
+#if DEBUG
+		in->sequencer.current_direction = kDirection_Forward;
+		//clockInterruptCallback();
+#endif
+	} else if (ls_btnMapValue(packet) == LS_BT_DOWN_ARROW && ls_btnIsDown(packet)) {
+#if DEBUG
+		in->sequencer.current_direction = kDirection_Backward;
+		//clockInterruptCallback();
+#endif
+	} else if (ls_btnMapValue(packet) == LS_BT_UNDO && ls_btnIsDown(packet) && in->ls.shift_btn_hold) {
+		// an accidental clear is one press away from coming back
+		edits_push(&in->edits, 0, kEditCommand_Undo, 0, 0, 0);
+	} else if (ls_btnMapValue(packet) == LS_BT_REDO && ls_btnIsDown(packet) && in->ls.shift_btn_hold) {
+		edits_push(&in->edits, 0, kEditCommand_Redo, 0, 0, 0);
+	} else if (ls_btnMapValue(packet) == LS_BT_LEFT_ARROW && ls_btnIsDown(packet)) {
+		ls_incrPageIndex(&in->ls, -1);
+	} else if (ls_btnMapValue(packet) == LS_BT_RIGHT_ARROW && ls_btnIsDown(packet)) {
+		ls_incrPageIndex(&in->ls, 1);
+	} else if (ls_btnMapValue(packet) == LS_BT_RESET && ls_btnIsDown(packet)) {
+#if DEBUG
+		sequencer_resetCurrentStepIndexes(&in->sequencer, in->ls.current_sequence_index);
+#endif
+	} else if (ls_btnMapValue(packet) == LS_BT_MODE && ls_btnIsDown(packet)) {
+		//TODO: method
+		in->ls.current_view_mode = (LaunchpadViewMode)utils_circularLoopGetIndex(in->ls.current_view_mode, 1, kLaunchpadViewMode_Settings);
+		//in->ls.current_view_mode = !in->ls.current_view_mode;
+		ls_updateDisplay(&in->ls);
+	} else {
+		result = false;
+	}
+	
+	return result;
+}
+
+bool processColButton(app_instance_t * in, SLMIDIPacket *packet) {
+	//uint16_t baseValue = LS_BT_VOL;
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		/*
+		 BT VALUE Example:
+		 0x9008
+		 0x9018
+		 0x9028
+		 */
+		uint16_t v = 0x90 << 8 | i << 4 | 0x08;
+		if (ls_btnMapValue(packet) == v && ls_btnIsDown(packet)) {
+			if (in->ls.sequence_view_mode == kLaunchpadSequenceViewMode_Paginated && in->ls.current_view_mode != kLaunchpadViewMode_Lanes) {
+				if (in->ls.clear_btn_hold) {
+					edits_push(&in->edits, 0, kEditCommand_ClearPattern, in->ls.current_sequence_index, i, 0);
+				}
+				
+				if (in->ls.current_view_mode == kLaunchpadViewMode_Mute) {
+					edits_push(&in->edits, 0, kEditCommand_ToggleMute, 0, i, 0);
+				}
+			} else {
+				in->ls.trigger_index = i;
+				ls_updateDisplay(&in->ls);
+			}
+			
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+bool processGridButton(app_instance_t * in, SLMIDIPacket *packet) {
+	SLMIDIMessageType   type = packet->data[0] & 0xF0;
+	uint8_t             incommingChannel = packet->data[0] & 0x0F;
+	
+	if (ls_btnIsDown(packet)) {
+		if (type == kSLMIDIMessageType_NoteOn) {
+			uint8_t x = packet->data[1] % 16;
+			uint8_t y = (packet->data[1] - x) / 16;
+			
+			switch(in->ls.current_view_mode) {
+				case kLaunchpadViewMode_Pattern:
+				case kLaunchpadViewMode_Mute:
+					if (!in->ls.shift_btn_hold) {
+						//toggle one step
+						ls_toggleStep(&in->ls, x, y);
+					} else {
+						//determines the last step
+						ls_updateLastStepIndex(&in->ls, x, y);
+					}
+					break;
+				case kLaunchpadViewMode_Lanes:
+					// shift: back to the default
+					ls_setLaneStep(&in->ls, x, y, in->ls.shift_btn_hold);
+					break;
+				case kLaunchpadViewMode_Sequence:
+					if (x < 4 && y < 4) {
+						//sequence select section
+						uint8_t newSequenceIndex = x + 4 * y;
+						if (!in->ls.shift_btn_hold) {
+							ls_setCurrentSequenceIndex(&in->ls, newSequenceIndex);
+						} else {
+							edits_push(&in->edits, 0, kEditCommand_SetNextSequence, newSequenceIndex, 0, 0);
+						}
+					}
+					break;
+				default:
+					break;
+			}
+			
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+// ------
+
+step_sequence_t * getCurrentSequenceSQ(app_instance_t * in) {
+	return sequencer_getCurrentSequence(&in->sequencer);
+}
+
+// --- Interrupts ---
+
+void clockInterruptCallback(app_instance_t * in) {
+	/*
+	* When there is no clock in trigger no sequenced output will be triggered !
+	*/
+	
+	latency_recordSince(&in->app->latency_tick, in->app->internal_clock.last_tick_ns);
+	sequencer_clock(&in->sequencer);
+	// LEDs are drawn and flushed by the renderer
+}
+
+void wrap_tempo_tick(void * ctx) {
+	app_t * a = (app_t *)ctx;
+	const uint64_t now = tempo_now();
+	const uint64_t late = now > a->internal_clock.last_tick_ns ? now - a->internal_clock.last_tick_ns : 0;
+	
+	if (a->instance_count > 0) {
+		trace_write(&a->trace, kTraceEvent_Clock, (uint8_t)a->internal_clock.tick_index, 0, 0, late > UINT32_MAX ? UINT32_MAX : (uint32_t)late);
+	}
+	
+	in_rt_path = true;
+	// same tick for every instance, one after the other: they never drift apart
+	for (size_t i = 0; i < a->instance_count; i++) {
+		app_instance_t * in = &a->instances[i];
+		
+		scheduler_beginTick(&in->trigger_scheduler, a->internal_clock.last_tick_ns, now);
+		render_markOrigin(&in->renderer, kRenderOrigin_Tick, now);
+		// UI edits land between two ticks, quantized ones on a step
+		edits_apply(&in->edits, &in->sequencer, now, sequencer_isStepBoundary(&in->sequencer));
+		render_markOrigin(&in->renderer, kRenderOrigin_Input, in->edits.applied_origin_ns);
+		clockInterruptCallback(in);
+	}
+	in_rt_path = false;
+}
+
+void wrap_sc_dispatch(void * ctx, uint8_t triggerIndex, uint8_t value) {
+	updateOutput((app_instance_t *)ctx, triggerIndex, value);
+}
+
+void wrap_tempo_idle(void * ctx) {
+	app_t * a = (app_t *)ctx;
+	const uint64_t now = tempo_now();
+	
+	// no tick while waiting for an external start, edits still apply
+	in_rt_path = true;
+	for (size_t i = 0; i < a->instance_count; i++) {
+		app_instance_t * in = &a->instances[i];
+		
+		edits_apply(&in->edits, &in->sequencer, now, true);
+		render_markOrigin(&in->renderer, kRenderOrigin_Input, in->edits.applied_origin_ns);
+	}
+	in_rt_path = false;
+}
+
+// MIDI thread: transport goes through the edit queues like any other change, every instance follows
+
+void _app_pushTransport(app_t * a, EditCommandType type, uint16_t value) {
+	for (size_t i = 0; i < a->instance_count; i++) {
+		edits_push(&a->instances[i].edits, 0, type, 0, 0, value);
+	}
+}
+
+void wrap_mc_start(void * ctx) {
+	_app_pushTransport((app_t *)ctx, kEditCommand_Start, 0);
+}
+
+void wrap_mc_continue(void * ctx) {
+	_app_pushTransport((app_t *)ctx, kEditCommand_Play, 0);
+}
+
+void wrap_mc_stop(void * ctx) {
+	_app_pushTransport((app_t *)ctx, kEditCommand_Stop, 0);
+}
+
+void wrap_mc_position(void * ctx, uint16_t sixteenths) {
+	_app_pushTransport((app_t *)ctx, kEditCommand_Locate, sixteenths);
+}
+
+void resetInterruptCallback(app_instance_t * in) {
+	//TODO: fix & check if play/stop necessary (normally no)
+	sequencer_locate(&in->sequencer, 0);
+	sequencer_stop(&in->sequencer);
+	sequencer_play(&in->sequencer);
+}
+
+void dirInterruptCallback(app_instance_t * in) {
+	in->sequencer.current_direction = !in->sequencer.current_direction;
+}
+
+void updateOutput(app_instance_t * in, size_t outputIndex, uint8_t value) {
+	if (outputIndex < N_TRIGGERS) {
+		//digitalWrite(t_outputs[outputIndex], value > 0 ? HIGH : LOW);
+	}
+}
+
+#if defined(__APPLE__) || defined(__linux__)
+
+void * _app_dispatchThread(void * arg) {
+	app_t * a = (app_t *)arg;
+	
+	while (a->running) {
+		tempo_sleepUntil(app_dispatch(a, tempo_now()));
+	}
+	
+	return NULL;
+}
+
+void * _app_renderThread(void * arg) {
+	app_worker_t * w = (app_worker_t *)arg;
+	app_t * a = w->app;
+	uint64_t deadline = tempo_now();
+	
+	while (a->running) {
+		app_render(a, w->index, w->count);
+		
+		// fixed frame rate, skip frames rather than catching up
+		deadline += RENDER_DEFAULT_PERIOD_NS;
+		const uint64_t now = tempo_now();
+		if (deadline < now) {
+			deadline = now;
+		}
+		tempo_sleepUntil(deadline);
+	}
+	
+	return NULL;
+}
+
+#endif
+
+// --- MAIN ---
+
+void app_init(app_t * a, const app_host_t * host) {
+	// Setup interrupts
+	//attachInterrupt(digitalPinToInterrupt(CLOCK_IN_PIN), clockInterruptCallback, RISING);
+	//attachInterrupt(digitalPinToInterrupt(RESET_PIN), resetInterruptCallback, RISING);
+	//attachInterrupt(digitalPinToInterrupt(DIR_PIN), dirInterruptCallback, RISING);
+	
+	a->instance_count = 0;
+	a->clock_out_state = kSequencerState_Stopped;
+	a->worker_count = 0;
+	a->running = false;
+	
+	// Binary records instead of printf, drained by the host off the clock thread
+	trace_init(&a->trace);
+	latency_init(&a->latency_tick, "timer -> clock");
+	
+	// Internal clock: absolute deadlines on its own thread (no drift), shared by every instance
+	tempo_init(&a->internal_clock);
+	tempo_setBpm(&a->internal_clock, DEFAULT_BPM);
+	tempo_setPpqn(&a->internal_clock, DEFAULT_PPQN);
+	a->internal_clock.tick_cb = wrap_tempo_tick;
+	a->internal_clock.idle_cb = wrap_tempo_idle;
+	a->internal_clock.ctx = a;
+	
+	// Free running until the DAW sends clock
+	midiclock_init(&a->external_clock, &a->internal_clock);
+	a->external_clock.start_cb = wrap_mc_start;
+	a->external_clock.continue_cb = wrap_mc_continue;
+	a->external_clock.stop_cb = wrap_mc_stop;
+	a->external_clock.position_cb = wrap_mc_position;
+	a->external_clock.ctx = a;
+	
+	// Clock out, sent ahead only when the host driver honours timestamps
+	midiclock_masterInit(&a->clock_out, &a->internal_clock, host->clock_timestamps);
+	a->clock_out.send_cb = host->clock_snd_cb;
+}
+
+app_instance_t * app_addInstance(app_t * a, void (*ls_snd_cb)(void * ctx, SLMIDIPacket * pkt, uint8_t channel), void * device) {
+	if (a->instance_count >= APP_MAX_INSTANCES) {
+		return NULL;
+	}
+	
+	app_instance_t * in = &a->instances[a->instance_count];
+	in->app = a;
+	in->index = a->instance_count;
+	
+	// Setup structs
+	sequencer_init(&in->sequencer);
+	in->sequencer.trace = &a->trace;
+	in->sequencer.ctx = in;
+	in->sequencer.step_updated_cb = wrap_sq_updateStep;
+	in->sequencer.playhead_updated_cb = wrap_sq_updatePlayhead;
+	in->sequencer.pattern_updated_cb = wrap_sq_updatePattern;
+	in->sequencer.state_updated_cb = wrap_sq_updateState;
+	in->sequencer.triggers_updated_cb = wrap_sq_updateTriggers;
+	in->sequencer.trigger_updated_cb = wrap_sq_updateTrigger;
+	in->sequencer.muted_triggers_updated_cb = wrap_sq_updateMutedTriggers;
+	in->sequencer.next_seq_index_updated_cb = wrap_sq_updateNextSequenceIndex;
+	in->sequencer.sequence_index_updated_cb = wrap_sq_updateSequenceIndex;
+	
+	latency_init(&in->latency_trigger, "clock -> trigger out");
+	latency_init(&in->latency_leds, "clock -> last LED");
+	latency_init(&in->latency_echo, "button -> LED echo");
+	
+	// Input threads never write the sequencer, the clock applies their edits
+	edits_init(&in->edits);
+	in->edits.quantize = edit_quantize;
+	history_init(&in->history);
+	in->edits.history = &in->history;
+	
+	ls_init(&in->ls, &in->sequencer);
+	in->ls.edits = &in->edits;
+	in->ls.trace = &a->trace;
+	in->ls.midi_snd_cb = ls_snd_cb;
+	in->ls.midi_rcv_cb = &wrap_ls_midi_rcv;
+	in->ls.ctx = device;
+	
+	// Clock ticks only publish LED changes, drawn at a fixed frame rate
+	render_init(&in->renderer);
+	in->renderer.step_cb = wrap_rd_drawStep;
+	in->renderer.pattern_cb = wrap_rd_drawPattern;
+	in->renderer.triggers_cb = wrap_rd_drawTriggers;
+	in->renderer.state_cb = wrap_rd_drawState;
+	in->renderer.sequence_cb = wrap_rd_followSequence;
+	in->renderer.input_cb = wrap_rd_input;
+	in->renderer.flush_cb = wrap_rd_flush;
+	in->renderer.ctx = in;
+	in->renderer.latency[kRenderOrigin_Tick] = &in->latency_leds;
+	in->renderer.latency[kRenderOrigin_Input] = &in->latency_echo;
+	
+	// Triggers are computed lookahead_ns early and output on time
+	scheduler_init(&in->trigger_scheduler);
+	in->trigger_scheduler.dispatch_cb = wrap_sc_dispatch;
+	in->trigger_scheduler.ctx = in;
+	in->trigger_scheduler.latency = &in->latency_trigger;
+	
+	// drawn by the first frame, the device inquiry with it. Loaded while no other thread sees
+	// the instance: the host thread is the renderer's only producer until then
+	in->version_requested = false;
+	sequencer_load(&in->sequencer, &preset_factory);
+	sequencer_play(&in->sequencer);
+	
+	// published before the clock or a worker can see it
+	atomic_thread_fence(memory_order_release);
+	a->instance_count++;
+	
+	return in;
+}
+
+bool app_loadBank(app_instance_t * in, const preset_bank_t * bank) {
+	// copied here into the staging sequences, the clock only flips them in at the boundary
+	return sequencer_stageBank(&in->sequencer, bank, bank_quantize) == N_SEQUENCES;
+}
+
+uint64_t app_dispatch(app_t * a, uint64_t now_ns) {
+	uint64_t next = UINT64_MAX;
+	
+	for (size_t i = 0; i < a->instance_count; i++) {
+		const uint64_t wakeup = scheduler_dispatch(&a->instances[i].trigger_scheduler, now_ns);
+		if (wakeup < next) {
+			next = wakeup;
+		}
+	}
+	
+	return next != UINT64_MAX ? next : now_ns + SCHEDULER_DEFAULT_LOOKAHEAD_NS / 2;
+}
+
+void app_render(app_t * a, uint8_t worker, uint8_t workers) {
+	// instance i always on the same worker: its Launchpad is only ever written by one thread
+	for (size_t i = worker; i < a->instance_count; i += workers) {
+		render_process(&a->instances[i].renderer);
+	}
+}
+
+#if defined(__APPLE__) || defined(__linux__)
+
+int app_startWorkers(app_t * a, uint8_t renderWorkers) {
+	if (a->running) {
+		return 0;
+	}
+	
+	if (renderWorkers == 0) {
+		renderWorkers = 1;
+	}
+	if (renderWorkers > APP_MAX_INSTANCES) {
+		renderWorkers = APP_MAX_INSTANCES;
+	}
+	
+	a->running = true;
+	
+	// triggers of every instance from one real-time thread, LEDs spread over normal ones
+	if (tempo_createThread(&a->dispatch_thread, _app_dispatchThread, a, SCHEDULER_THREAD_PRIORITY) < 0) {
+		a->running = false;
+		return -1;
+	}
+	
+	// every worker knows the stride before the first one runs
+	for (uint8_t i = 0; i < renderWorkers; i++) {
+		a->workers[i].app = a;
+		a->workers[i].index = i;
+		a->workers[i].count = renderWorkers;
+	}
+	for (uint8_t i = 0; i < renderWorkers; i++) {
+		if (pthread_create(&a->workers[i].thread, NULL, _app_renderThread, &a->workers[i]) != 0) {
+			// the instances of the missing worker would never be drawn
+			app_stopWorkers(a);
+			return -1;
+		}
+		a->worker_count++;
+	}
+	
+	return 1;
+}
+
+void app_stopWorkers(app_t * a) {
+	if (!a->running) {
+		return;
+	}
+	
+	a->running = false;
+	pthread_join(a->dispatch_thread, NULL);
+	for (uint8_t i = 0; i < a->worker_count; i++) {
+		pthread_join(a->workers[i].thread, NULL);
+	}
+	a->worker_count = 0;
+}
+
+#endif
+
+void app_printLatencies(app_t * a, FILE * out) {
+	latency_print(&a->latency_tick, out);
+	for (size_t i = 0; i < a->instance_count; i++) {
+		fprintf(out, "Launchpad %zu\n", i);
+		latency_print(&a->instances[i].latency_trigger, out);
+		latency_print(&a->instances[i].latency_leds, out);
+		latency_print(&a->instances[i].latency_echo, out);
+	}
+}
+
+void loop(void) {
+
+//	updateLeds(); // Update LEDs
+//	updateDisplay(); // Update Display
+	
+}
@@ -0,0 +1,100 @@
+//
+//  app.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#ifndef app_h
+#define app_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "launchpad.h"
+#include "sequencer.h"
+#include "tempo.h"
+#include "midiclock.h"
+#include "scheduler.h"
+#include "render.h"
+#include "edits.h"
+#include "trace.h"
+#include "latency.h"
+#include "history.h"
+
+#define APP_MAX_INSTANCES			4												// Launchpad + sequencer pairs, one clock
+
+/*
+*       Everything but the MIDI driver. A host (main.c: CoreMIDI, main_linux.c: ALSA) initialises
+*       one app_t, adds one instance per Launchpad with its send function and device, feeds
+*       wrap_ls_midi_rcv() with that instance and runs the engine parts, on worker threads
+*       (app_startWorkers) or from its event loop (app_dispatch, app_render).
+*       A Launchpad is only ever written by its renderer: device input is handed to it too.
+*       Instances share the clock, the trace ring and the clock out, nothing else:
+*       a button on one Launchpad never touches another's sequencer
+*/
+
+typedef struct app_t app_t;
+
+typedef struct app_host_t {
+	void						(*clock_snd_cb)(void * ctx, SLMIDIPacket * pkt);		// MIDI clock out
+	bool						clock_timestamps;								// clock_snd_cb honours future timestamps
+} app_host_t;
+
+typedef struct app_instance_t {
+	app_t *						app;
+	uint8_t						index;											// 0 drives the clock out
+	launchpad_t					ls;
+	step_sequencer_t			sequencer;
+	trigger_scheduler_t			trigger_scheduler;
+	render_queue_t				renderer;
+	edit_queue_t				edits;
+	history_t					history;										// pattern edits of this instance
+	bool						version_requested;								// render thread, device inquiry sent
+	latency_histogram_t			latency_trigger;
+	latency_histogram_t			latency_leds;
+	latency_histogram_t			latency_echo;
+} app_instance_t;
+
+typedef struct app_worker_t {
+	app_t *						app;
+	uint8_t						index;
+	uint8_t						count;											// workers sharing the instances, set before any starts
+#if defined(__APPLE__) || defined(__linux__)
+	pthread_t					thread;
+#endif
+} app_worker_t;
+
+struct app_t {
+	app_instance_t				instances[APP_MAX_INSTANCES];
+	volatile size_t				instance_count;
+	tempo_clock_t				internal_clock;
+	midi_clock_t				external_clock;
+	midi_clock_master_t			clock_out;
+	SequencerState				clock_out_state;
+	trace_ring_t				trace;
+	latency_histogram_t			latency_tick;
+	
+	// app_startWorkers: one dispatcher for every instance's triggers, renderers spread over the workers
+	app_worker_t				workers[APP_MAX_INSTANCES];
+	uint8_t						worker_count;									// started, host thread only
+	volatile bool				running;
+#if defined(__APPLE__) || defined(__linux__)
+	pthread_t					dispatch_thread;
+#endif
+};
+
+void 				app_init(app_t * a, const app_host_t * host);
+app_instance_t * 	app_addInstance(app_t * a, void (*ls_snd_cb)(void * ctx, SLMIDIPacket * pkt, uint8_t channel), void * device);	//NULL when full, device: ls_snd_cb's ctx
+bool 				app_loadBank(app_instance_t * in, const preset_bank_t * bank);			//any thread but the clock, false when a sequence was busy or lanes did not fit
+uint64_t 			app_dispatch(app_t * a, uint64_t now_ns);								//every instance's triggers, returns next wakeup
+void 				app_render(app_t * a, uint8_t worker, uint8_t workers);					//instances worker, worker + workers...
+#if defined(__APPLE__) || defined(__linux__)
+int 				app_startWorkers(app_t * a, uint8_t renderWorkers);					//-1: none left running
+void 				app_stopWorkers(app_t * a);
+#endif
+void 				app_printLatencies(app_t * a, FILE * out);
+void 				loop(void);
+void 				wrap_ls_midi_rcv(void * ctx, SLMIDIPacket * pkt);						//ctx: the app_instance_t the device is bound to, one thread per device
+
+#endif /* app_h */
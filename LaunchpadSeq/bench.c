@@ -0,0 +1,269 @@
+//
+//  bench.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#if defined(LS_BENCHMARK)
+
+/*
+*       Hot path microbenchmark, not part of the app:
+*       cc -O2 -DLS_BENCHMARK -o bench bench.c app.c launchpad.c sequencer.c sequence.c pattern.c \
+*          tempo.c midiclock.c scheduler.c render.c edits.c trace.c latency.c transport.c preset.c history.c lanes.c noalloc.c -lpthread
+*       Linux, -DLS_DEBUG_ALLOC added: every case also aborts on an allocation in a tick, a frame or a flush
+*
+*       Runs the app with a counting host (no MIDI driver) on a MK1 Launchpad, for both
+*       sequence view modes and empty / sparse / dense patterns, and reports per call:
+*       time, sequencer callbacks fired, MIDI messages and bytes sent to the Launchpad.
+*       The trace ring is on, as in production, and never drained
+*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "app.h"
+#include "transport.h"
+#include "preset.h"
+
+#define BENCH_TICKS					30000											// multiple of DEFAULT_CLOCK_DIVIDER
+#define BENCH_CALLS					30000
+
+typedef enum BenchFill {
+	kBenchFill_Empty = 0,
+	kBenchFill_Sparse,				// 1 step out of 4
+	kBenchFill_Dense,				// every step
+	kBenchFill_Count
+} BenchFill;
+
+typedef struct bench_counters_t {
+	uint64_t					callbacks;
+	uint64_t					messages;
+	uint64_t					bytes;
+} bench_counters_t;
+
+// app.c
+void wrap_tempo_tick(void * ctx);
+
+app_t						app;
+app_instance_t *			in;													// the only instance
+bench_counters_t			counters;
+midi_transport_t			parser;												// counts messages in sent packets
+step_sequencer_t			app_callbacks;										// app's callbacks, forwarded to
+
+const char *				fill_names[kBenchFill_Count] = { "empty", "sparse", "dense" };
+
+// --- Counting host ---
+
+void wrap_bc_ls_snd(void * ctx, SLMIDIPacket * pkt, uint8_t channel) {
+	counters.bytes += pkt->length;
+	transport_parse(&parser, pkt->data, pkt->length, 0);
+}
+
+void wrap_bc_clock_snd(void * ctx, SLMIDIPacket * pkt) {
+}
+
+void wrap_bc_message(void * ctx, SLMIDIPacket * pkt) {
+	counters.messages++;
+}
+
+// --- Counting sequencer callbacks ---
+
+void wrap_bc_step(void * ctx, uint8_t sequenceIndex, uint8_t pI, uint8_t sI) {
+	counters.callbacks++;
+	app_callbacks.step_updated_cb(ctx, sequenceIndex, pI, sI);
+}
+
+void wrap_bc_playhead(void * ctx, uint8_t sequenceIndex, uint8_t pI, uint8_t prevSI, uint8_t sI) {
+	counters.callbacks++;
+	app_callbacks.playhead_updated_cb(ctx, sequenceIndex, pI, prevSI, sI);
+}
+
+void wrap_bc_pattern(void * ctx, uint8_t sequenceIndex, uint8_t pI) {
+	counters.callbacks++;
+	app_callbacks.pattern_updated_cb(ctx, sequenceIndex, pI);
+}
+
+void wrap_bc_state(void * ctx) {
+	counters.callbacks++;
+	app_callbacks.state_updated_cb(ctx);
+}
+
+void wrap_bc_trigger(void * ctx, uint8_t triggerIndex) {
+	counters.callbacks++;
+	app_callbacks.trigger_updated_cb(ctx, triggerIndex);
+}
+
+void wrap_bc_triggers(void * ctx) {
+	counters.callbacks++;
+	app_callbacks.triggers_updated_cb(ctx);
+}
+
+void wrap_bc_sequenceIndex(void * ctx, uint8_t sequenceIndex) {
+	counters.callbacks++;
+	app_callbacks.sequence_index_updated_cb(ctx, sequenceIndex);
+}
+
+void wrap_bc_nextSequenceIndex(void * ctx) {
+	counters.callbacks++;
+	app_callbacks.next_seq_index_updated_cb(ctx);
+}
+
+// -----------------------------------------------------------------
+
+void benchSetup(void) {
+	const app_host_t host = {
+		.clock_snd_cb = wrap_bc_clock_snd,
+		.clock_timestamps = false
+	};
+	
+	transport_init(&parser);
+	parser.receive_cb = wrap_bc_message;
+	app_init(&app, &host);
+	in = app_addInstance(&app, wrap_bc_ls_snd, NULL);
+	
+	memcpy(&app_callbacks, &in->sequencer, sizeof(in->sequencer));
+	in->sequencer.step_updated_cb = wrap_bc_step;
+	in->sequencer.playhead_updated_cb = wrap_bc_playhead;
+	in->sequencer.pattern_updated_cb = wrap_bc_pattern;
+	in->sequencer.state_updated_cb = wrap_bc_state;
+	in->sequencer.trigger_updated_cb = wrap_bc_trigger;
+	in->sequencer.triggers_updated_cb = wrap_bc_triggers;
+	in->sequencer.sequence_index_updated_cb = wrap_bc_sequenceIndex;
+	in->sequencer.next_seq_index_updated_cb = wrap_bc_nextSequenceIndex;
+}
+
+void benchScenario(LaunchpadSequenceViewMode mode, BenchFill fill) {
+	step_sequence_t * sq = sequencer_getSequence(&in->sequencer, 0);
+	
+	// a bank a previous case left armed is swapped in first: edits would go to its staged copy
+	for (uint32_t i = 0; i < BENCH_TICKS && atomic_load(&in->sequencer.staging_states[0]) == kSequenceStaging_Armed; i++) {
+		wrap_tempo_tick(&app);
+	}
+	
+	// 16 steps everywhere, whatever a previous case loaded
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		seq_setLanes(sq, i, NULL);
+	}
+	seq_init(sq, sq->lane_pool);
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		uint64_t gates = 0;
+		for (size_t j = 0; j < DEFAULT_STEPS; j++) {
+			if (fill == kBenchFill_Dense || (fill == kBenchFill_Sparse && j % 4 == 0)) {
+				gates |= STEP_BIT(j);
+			}
+		}
+		seq_setPattern(sq, i, gates, DEFAULT_STEPS, false);
+	}
+	
+	sequencer_locate(&in->sequencer, 0);
+	ls_setSequenceViewMode(&in->ls, mode);
+	ls_updateDisplay(&in->ls);
+	ls_flush(&in->ls);
+	render_process(&in->renderer);
+	memset(&counters, 0x00, sizeof(counters));
+}
+
+void benchReport(const char * name, LaunchpadSequenceViewMode mode, BenchFill fill, uint64_t elapsed_ns, uint32_t calls) {
+	printf("%-22s %-9s %-7s %10.1f %8.2f %8.2f %9.2f\n",
+		   name,
+		   mode == kLaunchpadSequenceViewMode_Grid ? "grid" : "paginated",
+		   fill_names[fill],
+		   (double)elapsed_ns / calls,
+		   (double)counters.callbacks / calls,
+		   (double)counters.messages / calls,
+		   (double)counters.bytes / calls);
+}
+
+void benchRun(LaunchpadSequenceViewMode mode, BenchFill fill) {
+	uint64_t t0;
+	uint8_t prev[N_TRIGGERS];
+	
+	// what the clock thread did before the renderer: draw in place, flush every tick
+	benchScenario(mode, fill);
+	t0 = tempo_now();
+	for (uint32_t i = 0; i < BENCH_TICKS; i++) {
+		sequencer_clock(&in->sequencer);
+		ls_flush(&in->ls);
+	}
+	benchReport("sequencer_clock+flush", mode, fill, tempo_now() - t0, BENCH_TICKS);
+	
+	// clock tick publishing to the render queue, one frame drawn per tick (worst case)
+	benchScenario(mode, fill);
+	t0 = tempo_now();
+	for (uint32_t i = 0; i < BENCH_TICKS; i++) {
+		wrap_tempo_tick(&app);
+		scheduler_dispatch(&in->trigger_scheduler, UINT64_MAX);
+		render_process(&in->renderer);
+	}
+	benchReport("tick+render frame", mode, fill, tempo_now() - t0, BENCH_TICKS);
+	
+	benchScenario(mode, fill);
+	t0 = tempo_now();
+	for (uint32_t i = 0; i < BENCH_CALLS; i++) {
+		seq_incrCurrentStepIndexes(sequencer_getSequence(&in->sequencer, 0), 1, prev);
+	}
+	benchReport("seq_incrStepIndexes", mode, fill, tempo_now() - t0, BENCH_CALLS);
+	
+	// bank switch mid-set: staged by the caller, flipped in by the clock on the next step
+	benchScenario(mode, fill);
+	t0 = tempo_now();
+	for (uint32_t i = 0; i < BENCH_TICKS; i++) {
+		sequencer_stageBank(&in->sequencer, &preset_factory, kSwapQuantize_Step);
+		wrap_tempo_tick(&app);
+	}
+	benchReport("bank stage+tick", mode, fill, tempo_now() - t0, BENCH_TICKS);
+	
+	// full redraw, the shadow is invalidated so every LED is really sent
+	benchScenario(mode, fill);
+	t0 = tempo_now();
+	for (uint32_t i = 0; i < BENCH_CALLS; i++) {
+		ls_invalidate(&in->ls);
+		ls_updateGrid(&in->ls);
+		ls_flush(&in->ls);
+	}
+	benchReport("ls_updateGrid+flush", mode, fill, tempo_now() - t0, BENCH_CALLS);
+	
+	// one cell per frame, forgotten by the shadow so it is really sent, flushed as the renderer would
+	benchScenario(mode, fill);
+	t0 = tempo_now();
+	for (uint32_t i = 0; i < BENCH_CALLS; i++) {
+		in->ls.grid_leds_shown[(i / LS_COLS) % LS_ROWS * LS_COLS + i % LS_COLS] = LS_COLOR_UNKNOWN;
+		ls_updateCell(&in->ls, i % LS_COLS, (i / LS_COLS) % LS_ROWS);
+		ls_flush(&in->ls);
+	}
+	benchReport("ls_updateCell+flush", mode, fill, tempo_now() - t0, BENCH_CALLS);
+	
+	// grid button press + release: handed to the renderer, edit applied as the clock would, echoed by the next frame
+	SLMIDIPacket press = { .timestamp = 0, .length = 3, .data = { kSLMIDIMessageType_NoteOn, 0x00, 0x7F } };
+	SLMIDIPacket release = { .timestamp = 0, .length = 3, .data = { kSLMIDIMessageType_NoteOn, 0x00, 0x00 } };
+	
+	benchScenario(mode, fill);
+	t0 = tempo_now();
+	for (uint32_t i = 0; i < BENCH_CALLS; i++) {
+		press.data[1] = release.data[1] = ((i / LS_COLS) % LS_ROWS) * 16 + i % LS_COLS;
+		wrap_ls_midi_rcv(in, &press);
+		render_process(&in->renderer);
+		edits_apply(&in->edits, &in->sequencer, UINT64_MAX, true);
+		wrap_ls_midi_rcv(in, &release);
+		render_process(&in->renderer);
+	}
+	benchReport("input grid press", mode, fill, tempo_now() - t0, BENCH_CALLS);
+}
+
+int main(int argc, const char * argv[]) {
+	benchSetup();
+	
+	printf("%-22s %-9s %-7s %10s %8s %8s %9s\n", "", "view", "steps", "ns/call", "cb/call", "msg/call", "bytes/call");
+	for (int mode = kLaunchpadSequenceViewMode_Grid; mode >= 0; mode--) {
+		for (int fill = 0; fill < kBenchFill_Count; fill++) {
+			benchRun((LaunchpadSequenceViewMode)mode, (BenchFill)fill);
+		}
+	}
+	printf("1 step = %d ticks = %u sequencer ticks\n", DEFAULT_CLOCK_DIVIDER, sequencer_stepTicks(&in->sequencer));
+	
+	return 0;
+}
+
+#endif
@@ -0,0 +1,279 @@
+//
+//  edits.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#include "edits.h"
+#include "tempo.h"
+#include "history.h"
+
+#include "noalloc.h"
+
+bool _edits_isPatternEdit(EditCommandType type) {
+	return type < kEditCommand_Start;
+}
+
+// the sequence the command writes, -1: none
+int _edits_sequence(const edit_queue_t * q, const edit_command_t * c) {
+	switch ((EditCommandType)c->type) {
+		case kEditCommand_ToggleStep:
+		case kEditCommand_SetStep:
+		case kEditCommand_SetLastStep:
+		case kEditCommand_LinkSteps:
+		case kEditCommand_SetLaneValue:
+		case kEditCommand_ClearPattern:
+		case kEditCommand_ClearAllPatterns:
+			return c->sequence_index >= 0 && c->sequence_index < N_SEQUENCES ? c->sequence_index : -1;
+		case kEditCommand_Undo:
+			return q->history != NULL ? history_undoSequence(q->history) : -1;
+		case kEditCommand_Redo:
+			return q->history != NULL ? history_redoSequence(q->history) : -1;
+		default:
+			return -1;
+	}
+}
+
+// more than one step at once: heard half done if made on the live copy
+bool _edits_isMultiStep(EditCommandType type) {
+	return type == kEditCommand_ClearPattern || type == kEditCommand_ClearAllPatterns
+		|| type == kEditCommand_Undo || type == kEditCommand_Redo;
+}
+
+// kEditCommand_SetLaneValue
+void _edits_laneValue(const edit_command_t * c, uint8_t * stepIndex, StepLane * lane, int * value) {
+	*stepIndex = c->value & 0x3F;
+	*lane = (StepLane)((c->value >> 6) & 0x03);
+	*value = *lane == kStepLane_Offset ? (int8_t)(c->value >> 8) : (c->value >> 8);
+}
+
+void _edits_recordLane(history_t * h, step_sequencer_t * s, const edit_command_t * c) {
+	uint8_t stepIndex;
+	StepLane lane;
+	int value;
+	
+	_edits_laneValue(c, &stepIndex, &lane, &value);
+	if (seq_getLaneValue(sequencer_getEditedSequence(s, (uint8_t)c->sequence_index), c->pattern_index, lane, stepIndex) != value) {
+		history_recordLane(h, s, (uint8_t)c->sequence_index, c->pattern_index, lane, stepIndex);
+	}
+}
+
+void _edits_setLane(step_sequencer_t * s, const edit_command_t * c) {
+	uint8_t stepIndex;
+	StepLane lane;
+	int value;
+	
+	_edits_laneValue(c, &stepIndex, &lane, &value);
+	sequencer_setLaneValue(s, (uint8_t)c->sequence_index, c->pattern_index, lane, stepIndex, value);
+}
+
+void _edits_record(history_t * h, step_sequencer_t * s, const edit_command_t * c) {
+	const uint8_t sequenceIndex = (uint8_t)c->sequence_index;
+	
+	if (sequenceIndex >= N_SEQUENCES || c->pattern_index >= N_TRIGGERS) {
+		return;
+	}
+	
+	// copy only the patterns this edit really changes
+	const step_sequence_t * sq = sequencer_getEditedSequence(s, sequenceIndex);
+	const step_pattern_t * p = &sq->patterns[c->pattern_index];
+	bool changes = false;
+	
+	history_begin(h);
+	switch ((EditCommandType)c->type) {
+		case kEditCommand_ToggleStep:
+			changes = c->value < MAX_STEPS;
+			break;
+		case kEditCommand_SetStep:
+			changes = pattern_getStep(p, c->value & 0xFF) != ((c->value >> 8) > 0 ? STEP_ON : 0x00);
+			break;
+		case kEditCommand_SetLastStep:
+			changes = sq->last_step_indexes[c->pattern_index] != (uint8_t)c->value;
+			break;
+		case kEditCommand_LinkSteps:
+			changes = sq->link_steps[c->pattern_index] != (c->value != 0);
+			break;
+		case kEditCommand_SetLaneValue:
+			_edits_recordLane(h, s, c);
+			break;
+		case kEditCommand_ClearPattern:
+			changes = p->gates != 0;
+			break;
+		case kEditCommand_ClearAllPatterns:
+			for (size_t i = 0; i < N_TRIGGERS; i++) {
+				if (sq->patterns[i].gates != 0) {
+					history_record(h, s, sequenceIndex, i);
+				}
+			}
+			break;
+		default:
+			break;
+	}
+	
+	if (changes) {
+		history_record(h, s, sequenceIndex, c->pattern_index);
+	}
+}
+
+void _edits_run(edit_queue_t * q, step_sequencer_t * s, const edit_command_t * c) {
+	const uint8_t sequenceIndex = (uint8_t)c->sequence_index;
+	
+	if (q->history != NULL) {
+		_edits_record(q->history, s, c);
+	}
+	
+	switch ((EditCommandType)c->type) {
+		case kEditCommand_ToggleStep:
+			sequencer_togglePatternStepValue(s, sequenceIndex, c->pattern_index, (uint8_t)c->value);
+			break;
+		case kEditCommand_SetStep:
+			sequencer_setPatternStepValue(s, sequenceIndex, c->pattern_index, c->value & 0xFF, c->value >> 8);
+			break;
+		case kEditCommand_SetLastStep:
+			sequencer_setLastStepIndex(s, sequenceIndex, c->pattern_index, (uint8_t)c->value);
+			break;
+		case kEditCommand_LinkSteps:
+			sequencer_linkPatternSteps(s, sequenceIndex, c->pattern_index, c->value != 0);
+			break;
+		case kEditCommand_SetLaneValue:
+			_edits_setLane(s, c);
+			break;
+		case kEditCommand_ClearPattern:
+			sequencer_clearPattern(s, sequenceIndex, c->pattern_index);
+			break;
+		case kEditCommand_ClearAllPatterns:
+			sequencer_clearAllPatterns(s, sequenceIndex);
+			break;
+		case kEditCommand_SetNextSequence:
+			sequencer_setNextSequenceIndex(s, c->sequence_index);
+			break;
+		case kEditCommand_ToggleMute:
+			if (c->pattern_index < N_TRIGGERS) {
+				sequencer_setMutedPattern(s, c->pattern_index, !s->muted_triggers[c->pattern_index]);
+			}
+			break;
+		case kEditCommand_Undo:
+			if (q->history != NULL) {
+				history_undo(q->history, s);
+			}
+			break;
+		case kEditCommand_Redo:
+			if (q->history != NULL) {
+				history_redo(q->history, s);
+			}
+			break;
+		case kEditCommand_Start:
+			sequencer_stop(s);
+			sequencer_locate(s, 0);
+			sequencer_play(s);
+			break;
+		case kEditCommand_Play:
+			sequencer_play(s);
+			break;
+		case kEditCommand_Stop:
+			sequencer_stop(s);
+			break;
+		case kEditCommand_Locate:
+			sequencer_locate(s, c->value);
+			break;
+		default:
+			break;
+	}
+}
+
+//-----------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------
+
+void edits_init(edit_queue_t * q) {
+	for (unsigned i = 0; i < EDITS_QUEUE_SIZE; i++) {
+		atomic_init(&q->slots[i].sequence, i);
+	}
+	atomic_init(&q->head, 0);
+	q->tail = 0;
+	atomic_init(&q->overflows, 0);
+	q->quantize = kEditQuantize_None;
+	q->staging_quantize = kSwapQuantize_Step;
+	q->latency_max_ns = 0;
+	q->applied_origin_ns = 0;
+	q->history = NULL;
+}
+
+bool edits_push(edit_queue_t * q, uint64_t time_ns, EditCommandType type, int8_t sequenceIndex, uint8_t patternIndex, uint16_t value) {
+	unsigned pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+	edit_slot_t * slot;
+	
+	// claim a slot, retry when another producer took it first
+	for (;;) {
+		slot = &q->slots[pos & (EDITS_QUEUE_SIZE - 1)];
+		const int diff = (int)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - pos);
+		
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			// full: the clock has not consumed a whole queue yet
+			atomic_fetch_add_explicit(&q->overflows, 1, memory_order_relaxed);
+			return false;
+		} else {
+			pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+		}
+	}
+	
+	edit_command_t * c = &slot->command;
+	c->time_ns = time_ns != 0 ? time_ns : tempo_now();
+	c->type = type;
+	c->sequence_index = sequenceIndex;
+	c->pattern_index = patternIndex;
+	c->quantize = q->quantize == kEditQuantize_Step && _edits_isPatternEdit(type);
+	c->value = value;
+	atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+	
+	return true;
+}
+
+uint8_t edits_apply(edit_queue_t * q, step_sequencer_t * s, uint64_t now_ns, bool stepBoundary) {
+	uint8_t applied = 0;
+	
+	q->applied_origin_ns = 0;
+	
+	// in push order: a deferred command holds back the ones behind it
+	while (applied < EDITS_QUEUE_SIZE) {
+		edit_slot_t * slot = &q->slots[q->tail & (EDITS_QUEUE_SIZE - 1)];
+		
+		if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != q->tail + 1) {
+			break;
+		}
+		
+		const edit_command_t * c = &slot->command;
+		if (c->time_ns > now_ns || (c->quantize && !stepBoundary)) {
+			break;
+		}
+		
+		// another thread staging the sequence (a bank) has it for a moment
+		const int sequenceIndex = _edits_sequence(q, c);
+		if (sequenceIndex >= 0 && atomic_load_explicit(&s->staging_states[sequenceIndex], memory_order_acquire) == kSequenceStaging_Editing) {
+			break;
+		}
+		// heard: staged whole, swapped in at the boundary
+		if (sequenceIndex >= 0 && _edits_isMultiStep((EditCommandType)c->type)
+			&& s->current_state == kSequencerState_Playing && sequenceIndex == s->current_sequence_index) {
+			sequencer_stageEdit(s, (uint8_t)sequenceIndex, q->staging_quantize);
+		}
+		
+		if (now_ns - c->time_ns > q->latency_max_ns) {
+			q->latency_max_ns = now_ns - c->time_ns;
+		}
+		if (applied == 0) {
+			q->applied_origin_ns = c->time_ns;
+		}
+		_edits_run(q, s, c);
+		
+		atomic_store_explicit(&slot->sequence, q->tail + EDITS_QUEUE_SIZE, memory_order_release);
+		q->tail++;
+		applied++;
+	}
+	
+	return applied;
+}
@@ -0,0 +1,84 @@
+//
+//  edits.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#ifndef edits_h
+#define edits_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "sequencer.h"
+
+typedef struct history_t history_t;
+
+#define EDITS_QUEUE_SIZE			64												// power of 2
+#define EDITS_LANE_VALUE(step, lane, value)	((uint16_t)((step) | (lane) << 6 | (uint8_t)(value) << 8))	// step 0-63, StepLane, lane value as a byte
+
+typedef enum EditCommandType {
+	kEditCommand_ToggleStep = 0,	// sequence, pattern, value: step
+	kEditCommand_SetStep,			// sequence, pattern, value: step | STEP_ON << 8
+	kEditCommand_SetLastStep,		// sequence, pattern, value: last step index
+	kEditCommand_LinkSteps,			// sequence, pattern, value: bool
+	kEditCommand_SetLaneValue,		// sequence, pattern, value: EDITS_LANE_VALUE
+	kEditCommand_ClearPattern,		// sequence, pattern
+	kEditCommand_ClearAllPatterns,	// sequence
+	kEditCommand_SetNextSequence,	// sequence (NO_NEXT_SEQUENCE allowed)
+	kEditCommand_ToggleMute,		// pattern
+	kEditCommand_Undo,				// last recorded pattern edit
+	kEditCommand_Redo,
+	// transport, never quantized
+	kEditCommand_Start,				// from the first step
+	kEditCommand_Play,
+	kEditCommand_Stop,
+	kEditCommand_Locate				// value: step
+} EditCommandType;
+
+typedef enum EditQuantize {
+	kEditQuantize_None = 0,			// next tick
+	kEditQuantize_Step = 1			// next step boundary
+} EditQuantize;
+
+typedef struct edit_command_t {
+	uint64_t					time_ns;										// not applied before (tempo_now() time base)
+	uint8_t						type;
+	int8_t						sequence_index;
+	uint8_t						pattern_index;
+	bool						quantize;
+	uint16_t					value;
+} edit_command_t;
+
+typedef struct edit_slot_t {
+	atomic_uint					sequence;										// == position: free, == position + 1: written
+	edit_command_t				command;
+} edit_slot_t;
+
+/*
+*       Any thread pushes, the clock thread applies in order between two ticks,
+*       so sequencer_clock() never sees a half done edit and nobody waits on a lock.
+*       An edit changing more than one step of the playing sequence (clear, undo, redo) is made
+*       on a staged copy, heard whole from the next staging_quantize boundary
+*/
+
+// multiple producers (MIDI input, UI) / single consumer (clock)
+typedef struct edit_queue_t {
+	edit_slot_t					slots[EDITS_QUEUE_SIZE];
+	atomic_uint					head;											// next write, claimed by CAS
+	unsigned					tail;											// next read, clock thread only
+	atomic_uint					overflows;
+	EditQuantize				quantize;										// given to pattern edits when pushed
+	SwapQuantize				staging_quantize;								// multi-step edits of the playing sequence
+	uint64_t					latency_max_ns;									// worst apply - push time
+	uint64_t					applied_origin_ns;								// push time of the oldest edit of the last edits_apply (0: none)
+	history_t *					history;										// pattern edits recorded for undo when set
+} edit_queue_t;
+
+void 				edits_init(edit_queue_t * q);
+bool 				edits_push(edit_queue_t * q, uint64_t time_ns, EditCommandType type, int8_t sequenceIndex, uint8_t patternIndex, uint16_t value);	//time_ns 0: now
+uint8_t 			edits_apply(edit_queue_t * q, step_sequencer_t * s, uint64_t now_ns, bool stepBoundary);	//clock thread, returns applied count
+
+#endif /* edits_h */
@@ -0,0 +1,161 @@
+//
+//  history.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#include "history.h"
+
+#include "noalloc.h"
+
+history_entry_t * _history_entry(history_t * h, unsigned index) {
+	return &h->entries[index & (HISTORY_SIZE - 1)];
+}
+
+void _history_evictOldest(history_t * h) {
+	// a whole action or nothing: half of one could not be undone
+	do {
+		h->tail++;
+	} while (h->tail != h->head && !_history_entry(h, h->tail)->first);
+	
+	if ((int)(h->cursor - h->tail) < 0) {
+		h->cursor = h->tail;
+	}
+	h->evicted++;
+}
+
+void _history_swap(history_entry_t * e, step_sequencer_t * s) {
+	const step_sequence_t * sq = sequencer_getEditedSequence(s, e->sequence_index);
+	
+	if (e->lane < kStepLane_Count) {
+		const int16_t value = (int16_t)seq_getLaneValue(sq, e->pattern_index, (StepLane)e->lane, e->last_step_index);
+		
+		sequencer_setLaneValue(s, e->sequence_index, e->pattern_index, (StepLane)e->lane, e->last_step_index, e->lane_value);
+		e->lane_value = value;
+		return;
+	}
+	
+	const history_entry_t current = {
+		.gates = sq->patterns[e->pattern_index].gates,
+		.sequence_index = e->sequence_index,
+		.pattern_index = e->pattern_index,
+		.last_step_index = sq->last_step_indexes[e->pattern_index],
+		.link_steps = sq->link_steps[e->pattern_index],
+		.first = e->first,
+		.lane = kStepLane_Count
+	};
+	
+	sequencer_setPattern(s, e->sequence_index, e->pattern_index, e->gates, e->last_step_index, e->link_steps);
+	*e = current;
+}
+
+// a new entry after the cursor, joining the open action if any
+history_entry_t * _history_push(history_t * h) {
+	// a new edit forgets what could have been redone
+	h->head = h->cursor;
+	if (h->head - h->tail == HISTORY_SIZE) {
+		_history_evictOldest(h);
+	}
+	
+	history_entry_t * e = _history_entry(h, h->head);
+	
+	e->first = !h->action_open;
+	h->action_open = true;
+	h->head++;
+	h->cursor = h->head;
+	
+	return e;
+}
+
+//-----------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------
+
+void history_init(history_t * h) {
+	h->tail = 0;
+	h->cursor = 0;
+	h->head = 0;
+	h->action_open = false;
+	h->evicted = 0;
+}
+
+void history_begin(history_t * h) {
+	h->action_open = false;
+}
+
+void history_record(history_t * h, step_sequencer_t * s, uint8_t sequenceIndex, uint8_t patternIndex) {
+	if (sequenceIndex >= N_SEQUENCES || patternIndex >= N_TRIGGERS) {
+		return;
+	}
+	
+	const step_sequence_t * sq = sequencer_getEditedSequence(s, sequenceIndex);
+	history_entry_t * e = _history_push(h);
+	
+	e->gates = sq->patterns[patternIndex].gates;
+	e->sequence_index = sequenceIndex;
+	e->pattern_index = patternIndex;
+	e->last_step_index = sq->last_step_indexes[patternIndex];
+	e->link_steps = sq->link_steps[patternIndex];
+	e->lane = kStepLane_Count;
+}
+
+void history_recordLane(history_t * h, step_sequencer_t * s, uint8_t sequenceIndex, uint8_t patternIndex, StepLane lane, uint8_t stepIndex) {
+	if (sequenceIndex >= N_SEQUENCES || patternIndex >= N_TRIGGERS || lane >= kStepLane_Count || stepIndex >= MAX_STEPS) {
+		return;
+	}
+	
+	history_entry_t * e = _history_push(h);
+	
+	e->lane_value = (int16_t)seq_getLaneValue(sequencer_getEditedSequence(s, sequenceIndex), patternIndex, lane, stepIndex);
+	e->sequence_index = sequenceIndex;
+	e->pattern_index = patternIndex;
+	e->last_step_index = stepIndex;
+	e->link_steps = false;
+	e->lane = lane;
+}
+
+int history_undo(history_t * h, step_sequencer_t * s) {
+	if (!history_canUndo(h)) {
+		return 0;
+	}
+	
+	// back to the first entry of the last action
+	do {
+		h->cursor--;
+		_history_swap(_history_entry(h, h->cursor), s);
+	} while (h->cursor != h->tail && !_history_entry(h, h->cursor)->first);
+	h->action_open = false;
+	
+	return 1;
+}
+
+int history_redo(history_t * h, step_sequencer_t * s) {
+	if (!history_canRedo(h)) {
+		return 0;
+	}
+	
+	// up to the next action
+	do {
+		_history_swap(_history_entry(h, h->cursor), s);
+		h->cursor++;
+	} while (h->cursor != h->head && !_history_entry(h, h->cursor)->first);
+	h->action_open = false;
+	
+	return 1;
+}
+
+bool history_canUndo(const history_t * h) {
+	return h->cursor != h->tail;
+}
+
+bool history_canRedo(const history_t * h) {
+	return h->cursor != h->head;
+}
+
+int history_undoSequence(const history_t * h) {
+	return history_canUndo(h) ? h->entries[(h->cursor - 1) & (HISTORY_SIZE - 1)].sequence_index : -1;
+}
+
+int history_redoSequence(const history_t * h) {
+	return history_canRedo(h) ? h->entries[h->cursor & (HISTORY_SIZE - 1)].sequence_index : -1;
+}
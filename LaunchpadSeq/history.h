@@ -0,0 +1,63 @@
+//
+//  history.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#ifndef history_h
+#define history_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "sequencer.h"
+
+#define HISTORY_SIZE				256												// power of 2, patterns kept (16 bytes each)
+
+/*
+*       Undo/redo at the granularity of one pattern: before an edit, only the patterns it
+*       is going to change are copied into a fixed pool. An action (one edit command) is the
+*       run of entries starting at a `first` one. Undo and redo swap each entry of an action
+*       with the pattern it was taken from, so the same entry holds what redo puts back.
+*       A lane edit is kept as the one step value it changed, not as 256 bytes of lanes.
+*       A full pool drops the oldest actions. Clock thread only, like the edits recording it.
+*       An action changes one sequence: the edit queue stages it before undoing or redoing it
+*/
+
+typedef struct history_entry_t {
+	union {
+		uint64_t				gates;
+		int16_t					lane_value;										// lane entry
+	};
+	uint8_t						sequence_index;
+	uint8_t						pattern_index;
+	uint8_t						last_step_index;								// or the step of a lane entry
+	bool						link_steps;
+	bool						first;											// first pattern of its action
+	uint8_t						lane;											// kStepLane_Count: pattern entry
+} history_entry_t;
+
+_Static_assert(sizeof(history_entry_t) == 16, "history_entry_t size");
+
+typedef struct history_t {
+	history_entry_t				entries[HISTORY_SIZE];
+	unsigned					tail;											// oldest kept
+	unsigned					cursor;											// undo before, redo from here
+	unsigned					head;											// end of the redo run
+	bool						action_open;									// next record joins the current action
+	uint32_t					evicted;										// actions dropped to make room
+} history_t;
+
+void 				history_init(history_t * h);
+void 				history_begin(history_t * h);												// next record starts an action
+void 				history_record(history_t * h, step_sequencer_t * s, uint8_t sequenceIndex, uint8_t patternIndex);	// pattern as it is before the edit
+void 				history_recordLane(history_t * h, step_sequencer_t * s, uint8_t sequenceIndex, uint8_t patternIndex, StepLane lane, uint8_t stepIndex);	// lane value as it is before the edit
+int 				history_undo(history_t * h, step_sequencer_t * s);							// 0: nothing to undo
+int 				history_redo(history_t * h, step_sequencer_t * s);							// 0: nothing to redo
+bool 				history_canUndo(const history_t * h);
+bool 				history_canRedo(const history_t * h);
+int 				history_undoSequence(const history_t * h);									// the sequence history_undo changes, -1: none
+int 				history_redoSequence(const history_t * h);
+
+#endif /* history_h */
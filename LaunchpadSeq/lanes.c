@@ -0,0 +1,217 @@
+//
+//  lanes.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#include "lanes.h"
+#include "utils.h"
+#include <string.h>
+
+#include "noalloc.h"
+
+bool _lanes_isValid(StepLane lane, int value) {
+	switch (lane) {
+		case kStepLane_Velocity:
+			return value == STEP_ON || (value >= 1 && value <= 127);
+		case kStepLane_Probability:
+			return value >= 0 && value <= LANE_PROBABILITY_ALWAYS;
+		case kStepLane_Ratchet:
+			return value >= 1 && value <= LANE_RATCHET_MAX;
+		case kStepLane_Offset:
+			return value >= -LANE_OFFSET_RESOLUTION / 2 && value < LANE_OFFSET_RESOLUTION / 2;
+		default:
+			return false;
+	}
+}
+
+const uint8_t * _lanes_values(const step_lanes_t * l, StepLane lane) {
+	switch (lane) {
+		case kStepLane_Velocity:
+			return l->velocities;
+		case kStepLane_Probability:
+			return l->probabilities;
+		case kStepLane_Ratchet:
+			return l->ratchets;
+		case kStepLane_Offset:
+			return (const uint8_t *)l->offsets;
+		default:
+			return NULL;
+	}
+}
+
+//-----------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------
+
+void lanes_init(step_lanes_t * l) {
+	memset(l->velocities, STEP_ON, sizeof(l->velocities));
+	memset(l->probabilities, LANE_PROBABILITY_ALWAYS, sizeof(l->probabilities));
+	memset(l->ratchets, 1, sizeof(l->ratchets));
+	memset(l->offsets, 0, sizeof(l->offsets));
+}
+
+void lanes_initPool(lane_pool_t * p) {
+	atomic_init(&p->used, 0);
+}
+
+uint8_t lanes_alloc(lane_pool_t * p) {
+	unsigned long long used = atomic_load_explicit(&p->used, memory_order_relaxed);
+	
+	// the clock and a staging writer may both take one: a compare and swap, no lock
+	while (~used != 0) {
+		const uint8_t slot = utils_lowestBit64(~used);
+		
+		if (slot >= LANE_POOL_SLOTS) {
+			break;
+		}
+		if (atomic_compare_exchange_weak_explicit(&p->used, &used, used | (1ULL << slot), memory_order_acquire, memory_order_relaxed)) {
+			lanes_init(&p->slots[slot]);
+			return slot;
+		}
+	}
+	
+	return LANE_NO_SLOT;
+}
+
+void lanes_release(lane_pool_t * p, uint8_t slot) {
+	if (slot < LANE_POOL_SLOTS) {
+		atomic_fetch_and_explicit(&p->used, ~(1ULL << slot), memory_order_release);
+	}
+}
+
+int lanes_default(StepLane lane) {
+	switch (lane) {
+		case kStepLane_Velocity:
+			return STEP_ON;
+		case kStepLane_Probability:
+			return LANE_PROBABILITY_ALWAYS;
+		case kStepLane_Ratchet:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+int lanes_getValue(const step_lanes_t * l, StepLane lane, size_t index) {
+	if (index >= MAX_STEPS) {
+		return lanes_default(lane);
+	}
+	
+	switch (lane) {
+		case kStepLane_Velocity:
+			return l->velocities[index];
+		case kStepLane_Probability:
+			return l->probabilities[index];
+		case kStepLane_Ratchet:
+			return l->ratchets[index];
+		case kStepLane_Offset:
+			return l->offsets[index];
+		default:
+			return 0;
+	}
+}
+
+int lanes_setValue(step_lanes_t * l, StepLane lane, size_t index, int value) {
+	if (index >= MAX_STEPS || !_lanes_isValid(lane, value)) {
+		return -1;
+	}
+	
+	if (lanes_getValue(l, lane, index) == value) {
+		return 0;
+	}
+	
+	switch (lane) {
+		case kStepLane_Velocity:
+			l->velocities[index] = (uint8_t)value;
+			break;
+		case kStepLane_Probability:
+			l->probabilities[index] = (uint8_t)value;
+			break;
+		case kStepLane_Ratchet:
+			l->ratchets[index] = (uint8_t)value;
+			break;
+		case kStepLane_Offset:
+			l->offsets[index] = (int8_t)value;
+			break;
+		default:
+			break;
+	}
+	
+	return 1;
+}
+
+int lanes_validate(const step_lanes_t * l) {
+	for (size_t i = 0; i < kStepLane_Count; i++) {
+		for (size_t j = 0; j < MAX_STEPS; j++) {
+			if (!_lanes_isValid((StepLane)i, lanes_getValue(l, (StepLane)i, j))) {
+				return -1;
+			}
+		}
+	}
+	
+	return 1;
+}
+
+uint8_t lanes_countEdited(const step_lanes_t * l, StepLane lane) {
+	const uint8_t * values = _lanes_values(l, lane);
+	const uint8_t value = (uint8_t)lanes_default(lane);
+	uint8_t count = 0;
+	
+	if (values == NULL) {
+		return 0;
+	}
+	
+	// a whole lane at once, the bytes as stored
+	for (size_t i = 0; i < MAX_STEPS; i++) {
+		count += values[i] != value;
+	}
+	
+	return count;
+}
+
+uint8_t lanes_toLevel(StepLane lane, int value) {
+	int level;
+	
+	switch (lane) {
+		case kStepLane_Velocity:
+			level = value == STEP_ON ? LANE_LEVELS : (value + 15) / 16;
+			break;
+		case kStepLane_Probability:
+			level = (value * LANE_LEVELS + LANE_PROBABILITY_ALWAYS - 1) / LANE_PROBABILITY_ALWAYS;
+			break;
+		case kStepLane_Ratchet:
+			level = value;
+			break;
+		case kStepLane_Offset:
+			// no offset on the 5th level, an eighth of a step per level
+			level = (value + LANE_OFFSET_RESOLUTION / 2) / 16 + 1;
+			break;
+		default:
+			level = 0;
+			break;
+	}
+	
+	return level < 0 ? 0 : (level > LANE_LEVELS ? LANE_LEVELS : (uint8_t)level);
+}
+
+int lanes_fromLevel(StepLane lane, uint8_t level) {
+	if (level < 1) {
+		level = 1;
+	} else if (level > LANE_LEVELS) {
+		level = LANE_LEVELS;
+	}
+	
+	switch (lane) {
+		case kStepLane_Velocity:
+			return level * 16 - 1;
+		case kStepLane_Probability:
+			return level * LANE_PROBABILITY_ALWAYS / LANE_LEVELS;
+		case kStepLane_Ratchet:
+			return level;
+		case kStepLane_Offset:
+			return (level - 5) * 16;
+		default:
+			return 0;
+	}
+}
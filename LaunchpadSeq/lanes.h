@@ -0,0 +1,78 @@
+//
+//  lanes.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#ifndef lanes_h
+#define lanes_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "pattern.h"
+
+#define LANE_BIT(lane)				(1 << (lane))
+#define LANE_LEVELS					8												// values a lane is edited with, one per grid row
+#define LANE_PROBABILITY_ALWAYS		100												// percent
+#define LANE_RATCHET_MAX			8												// hits in one step
+#define LANE_OFFSET_RESOLUTION		128												// offset units per step: -64..63 is half a step either way
+#ifndef LANE_POOL_SLOTS
+#define LANE_POOL_SLOTS				64												// patterns with an edited lane, every sequence and copy together, 64 at most
+#endif
+#define LANE_NO_SLOT				0xFF
+
+typedef enum StepLane {
+	kStepLane_Velocity = 0,			// STEP_ON (as without the lane) or 1-127
+	kStepLane_Probability,			// 0-100 %
+	kStepLane_Ratchet,				// 1-LANE_RATCHET_MAX hits
+	kStepLane_Offset,				// signed, 1/LANE_OFFSET_RESOLUTION step
+	kStepLane_Count
+} StepLane;
+
+/*
+*       Optional per-step parameters of one pattern, an array per parameter next to the gates
+*       rather than a struct per step: the clock reads a lane only for a set gate of a pattern
+*       using it, and a gate only tick never loads any of them.
+*       Every step holds its lane's default until edited, which plays as if there was no lane.
+*       Few patterns use them: a pattern holds a slot of its sequencer's pool only while one of
+*       its lanes is off the default, a gate only sequence none
+*/
+
+typedef struct step_lanes_t {
+	uint8_t						velocities[MAX_STEPS];
+	uint8_t						probabilities[MAX_STEPS];
+	uint8_t						ratchets[MAX_STEPS];
+	int8_t						offsets[MAX_STEPS];
+} step_lanes_t;
+
+// initializer of a const step_lanes_t, same as lanes_init
+#define LANES_DEFAULT				{ \
+	.velocities = { [0 ... MAX_STEPS - 1] = STEP_ON }, \
+	.probabilities = { [0 ... MAX_STEPS - 1] = LANE_PROBABILITY_ALWAYS }, \
+	.ratchets = { [0 ... MAX_STEPS - 1] = 1 }, \
+	.offsets = { 0 } \
+}
+
+typedef struct lane_pool_t {
+	step_lanes_t				slots[LANE_POOL_SLOTS];
+	atomic_ullong				used;											// bit n: slot n, taken by any thread
+} lane_pool_t;
+
+_Static_assert(LANE_POOL_SLOTS <= 64, "lane_pool_t.used");
+
+void 			lanes_init(step_lanes_t * l);
+void 			lanes_initPool(lane_pool_t * p);
+uint8_t 		lanes_alloc(lane_pool_t * p);												// a slot at the defaults, LANE_NO_SLOT when full
+void 			lanes_release(lane_pool_t * p, uint8_t slot);
+int 			lanes_default(StepLane lane);
+int 			lanes_getValue(const step_lanes_t * l, StepLane lane, size_t index);
+int 			lanes_setValue(step_lanes_t * l, StepLane lane, size_t index, int value);	// 1 if changed, -1 out of range
+int 			lanes_validate(const step_lanes_t * l);									//-1 a value out of its lane's range
+uint8_t 		lanes_countEdited(const step_lanes_t * l, StepLane lane);					// steps off the default
+uint8_t 		lanes_toLevel(StepLane lane, int value);									// 0-LANE_LEVELS
+int 			lanes_fromLevel(StepLane lane, uint8_t level);								// level 1-LANE_LEVELS
+
+#endif /* lanes_h */
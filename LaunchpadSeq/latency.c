@@ -0,0 +1,127 @@
+//
+//  latency.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#include "latency.h"
+#include "tempo.h"
+#include "utils.h"
+
+#include "noalloc.h"
+
+size_t _latency_bucket(uint64_t value) {
+	if (value < LATENCY_SUB_BUCKETS) {
+		return (size_t)value;
+	}
+	
+	const uint8_t shift = utils_highestBit64(value) - LATENCY_SUB_BITS;
+	
+	return (size_t)(shift + 1) * LATENCY_SUB_BUCKETS + ((value >> shift) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+uint64_t _latency_bucketMax(size_t bucket) {
+	if (bucket < LATENCY_SUB_BUCKETS) {
+		return bucket;
+	}
+	
+	const uint8_t shift = (uint8_t)(bucket / LATENCY_SUB_BUCKETS - 1);
+	const uint64_t first = (uint64_t)(LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS) << shift;
+	
+	return first + ((1ULL << shift) - 1);
+}
+
+//-----------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------
+
+void latency_init(latency_histogram_t * h, const char * name) {
+	h->name = name;
+	for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+		atomic_init(&h->counts[i], 0);
+	}
+	atomic_init(&h->count, 0);
+	atomic_init(&h->sum_ns, 0);
+	atomic_init(&h->min_ns, UINT64_MAX);
+	atomic_init(&h->max_ns, 0);
+}
+
+void latency_reset(latency_histogram_t * h) {
+	for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+		atomic_store_explicit(&h->counts[i], 0, memory_order_relaxed);
+	}
+	atomic_store_explicit(&h->count, 0, memory_order_relaxed);
+	atomic_store_explicit(&h->sum_ns, 0, memory_order_relaxed);
+	atomic_store_explicit(&h->min_ns, UINT64_MAX, memory_order_relaxed);
+	atomic_store_explicit(&h->max_ns, 0, memory_order_relaxed);
+}
+
+void latency_record(latency_histogram_t * h, uint64_t value_ns) {
+	if (h == NULL) {
+		return;
+	}
+	
+	atomic_fetch_add_explicit(&h->counts[_latency_bucket(value_ns)], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&h->sum_ns, value_ns, memory_order_relaxed);
+	
+	// only loops when another thread moved the bound at the same time
+	unsigned long long bound = atomic_load_explicit(&h->min_ns, memory_order_relaxed);
+	while (value_ns < bound && !atomic_compare_exchange_weak_explicit(&h->min_ns, &bound, value_ns, memory_order_relaxed, memory_order_relaxed));
+	bound = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+	while (value_ns > bound && !atomic_compare_exchange_weak_explicit(&h->max_ns, &bound, value_ns, memory_order_relaxed, memory_order_relaxed));
+}
+
+void latency_recordSince(latency_histogram_t * h, uint64_t start_ns) {
+	if (h == NULL || start_ns == 0) {
+		return;
+	}
+	
+	const uint64_t now = tempo_now();
+	latency_record(h, now > start_ns ? now - start_ns : 0);
+}
+
+uint64_t latency_percentile(latency_histogram_t * h, double percentile) {
+	const uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+	const uint64_t max = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+	uint64_t target = (uint64_t)(percentile / 100.0 * count + 0.5);
+	uint64_t seen = 0;
+	
+	if (count == 0) {
+		return 0;
+	}
+	if (target == 0) {
+		target = 1;
+	}
+	
+	for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+		seen += atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+		if (seen >= target) {
+			const uint64_t value = _latency_bucketMax(i);
+			return value < max ? value : max;
+		}
+	}
+	
+	return max;
+}
+
+void latency_print(latency_histogram_t * h, FILE * out) {
+	const uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+	
+	if (count == 0) {
+		fprintf(out, "%-26s no sample\n", h->name);
+		return;
+	}
+	
+	// us, what matters on stage
+	fprintf(out, "%-26s n %-8llu min %8.1f  p50 %8.1f  p90 %8.1f  p99 %8.1f  p99.9 %8.1f  max %8.1f  mean %8.1f us\n",
+			h->name,
+			(unsigned long long)count,
+			atomic_load_explicit(&h->min_ns, memory_order_relaxed) / 1000.0,
+			latency_percentile(h, 50.0) / 1000.0,
+			latency_percentile(h, 90.0) / 1000.0,
+			latency_percentile(h, 99.0) / 1000.0,
+			latency_percentile(h, 99.9) / 1000.0,
+			atomic_load_explicit(&h->max_ns, memory_order_relaxed) / 1000.0,
+			(double)atomic_load_explicit(&h->sum_ns, memory_order_relaxed) / count / 1000.0);
+}
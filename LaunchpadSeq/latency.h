@@ -0,0 +1,42 @@
+//
+//  latency.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#ifndef latency_h
+#define latency_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define LATENCY_SUB_BITS			3												// 8 buckets per power of 2, <= 12.5% error
+#define LATENCY_SUB_BUCKETS			(1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS				((64 - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS)	// any uint64_t
+
+/*
+*       HDR style histogram: exact below 8 ns, then each power of 2 split in 8 linear buckets.
+*       Fixed memory, recording is a few relaxed atomic adds from any thread, readers may query
+*       it while it is being written (counts are then off by the records in flight).
+*/
+
+typedef struct latency_histogram_t {
+	const char *				name;
+	atomic_uint					counts[LATENCY_BUCKETS];
+	atomic_ullong				count;
+	atomic_ullong				sum_ns;
+	atomic_ullong				min_ns;
+	atomic_ullong				max_ns;
+} latency_histogram_t;
+
+void 				latency_init(latency_histogram_t * h, const char * name);
+void 				latency_reset(latency_histogram_t * h);
+void 				latency_record(latency_histogram_t * h, uint64_t value_ns);				//h may be NULL
+void 				latency_recordSince(latency_histogram_t * h, uint64_t start_ns);			//tempo_now() - start_ns, nothing if start_ns is 0
+uint64_t 			latency_percentile(latency_histogram_t * h, double percentile);			//0-100, bucket upper bound
+void 				latency_print(latency_histogram_t * h, FILE * out);
+
+#endif /* latency_h */
@@ -6,16 +6,30 @@
 //
 
 #include <stdio.h>
-#include <stdlib.h>
+#include <string.h>
 #include "sequencer.h"
 #include "launchpad.h"
+#include "edits.h"
+#include "trace.h"
 #include "utils.h"
 
+#include "noalloc.h"
+
 void ls_init(launchpad_t * l, step_sequencer_t * seq) {
+	memset(l->grid_leds, LS_COLOR_NONE, sizeof(l->grid_leds));
+	memset(l->ext_leds, LS_COLOR_NONE, sizeof(l->ext_leds));
+	memset(&l->out_queue, 0x00, sizeof(l->out_queue));
+	l->version = kLaunchpadVersion_MK1;
+	ls_invalidate(l);
+	
 	l->shift_btn_hold = false;
 	l->clear_btn_hold = false;
 	l->sequencer = seq;
+	l->edits = NULL;
+	l->ctx = NULL;
+	l->trace = NULL;
 	l->auto_follow_sequence = true;
+	l->lane_index = kStepLane_Velocity;
 	ls_setSequenceViewMode(l, kLaunchpadSequenceViewMode_Grid);
 	
 	if (seq != NULL) {
@@ -24,9 +38,39 @@ void ls_init(launchpad_t * l, step_sequencer_t * seq) {
 }
 
 void ls_midi_send(launchpad_t * l, SLMIDIPacket * pkt, uint8_t channel) {
+	ls_midi_queue_t * q = &l->out_queue;
+	
+	if (pkt == NULL || pkt->length > SL_MIDI_PACKET_MAX_LENGTH) {
+		return;
+	}
+	
+	// no room left: send what we have and start a new packet
+	if (q->pkt.length + pkt->length > SL_MIDI_PACKET_MAX_LENGTH) {
+		ls_midi_flushQueue(l);
+	}
+	
+	memcpy(&q->pkt.data[q->pkt.length], pkt->data, pkt->length);
+	q->pkt.length += pkt->length;
+	q->messages++;
+}
+
+size_t ls_midi_flushQueue(launchpad_t * l) {
+	ls_midi_queue_t * q = &l->out_queue;
+	
+	if (q->pkt.length == 0) {
+		return 0;
+	}
+	
 	if (l->midi_snd_cb != NULL) {
-		l->midi_snd_cb(pkt, channel);
+		l->midi_snd_cb(l->ctx, &q->pkt, 0);
 	}
+	
+	q->flushed_messages = q->messages;
+	q->flushed_bytes = q->pkt.length;
+	q->pkt.length = 0;
+	q->messages = 0;
+	
+	return q->flushed_messages;
 }
 
 void ls_incrPageIndex(launchpad_t * l, int8_t value) {
@@ -51,22 +95,470 @@ void ls_setCurrentSequenceIndex(launchpad_t * l, uint8_t sequenceIndex) {
 }
 
 
+// top row: 0xB068 -> 0xB06F => 0 -> 7
+// out column: 0x9008 -> 0x9078 => 8 -> 15
+int _ls_extButtonToIndex(uint16_t btnIndex) {
+	if ((btnIndex & 0xFFF8) == LS_BT_TOP_ROW_FIRST) {
+		return btnIndex & 0x07;
+	}
+	if ((btnIndex & 0xFF0F) == LS_BT_OUT_COL_FIRST) {
+		return 8 + ((btnIndex >> 4) & 0x07);
+	}
+	return -1;
+}
+
+uint16_t _ls_indexToExtButton(size_t index) {
+	if (index < 8) {
+		return LS_BT_TOP_ROW_FIRST + index;
+	}
+	return LS_BT_OUT_COL_FIRST | (((index - 8) << 4) & 0xf0);
+}
+
 void ls_setExtButton(launchpad_t * l, uint16_t btnIndex, uint8_t color) {
-	SLMIDIPacket pkt = {0};
-	pkt.length = 3;
-	pkt.data[0] = btnIndex >> 8;
-	pkt.data[1] = btnIndex & 0x00ff;
-	pkt.data[2] = color;
-	ls_midi_send(l, &pkt, 0);
+	const int i = _ls_extButtonToIndex(btnIndex);
+	if (i < 0) {
+		return;
+	}
+	
+	l->ext_leds[i] = color;
+	if (l->ext_leds_shown[i] != color) {
+		l->ext_dirty |= (1 << i);
+	}
 }
 
 void ls_setGridButton(launchpad_t * l, uint8_t x, uint8_t y, uint8_t color) {
-	SLMIDIPacket pkt = {0};
-	pkt.length = 3;
-	pkt.data[0] = kSLMIDIMessageType_NoteOn;
-	pkt.data[1] = LS_PKT_TO_GRID_POS(x, y);
-	pkt.data[2] = color;
-	ls_midi_send(l, &pkt, 0);
+	if (x >= LS_COLS || y >= LS_ROWS) {
+		return;
+	}
+	
+	const size_t i = x + (y * LS_COLS);
+	l->grid_leds[i] = color;
+	if (l->grid_leds_shown[i] != color) {
+		l->grid_dirty |= (1ULL << i);
+	}
+}
+
+void _ls_queueMessage(launchpad_t * l, uint8_t status, uint8_t data1, uint8_t data2) {
+	ls_midi_queue_t * q = &l->out_queue;
+	
+	if (q->pkt.length + 3 > SL_MIDI_PACKET_MAX_LENGTH) {
+		ls_midi_flushQueue(l);
+	}
+	
+	q->pkt.data[q->pkt.length++] = status;
+	q->pkt.data[q->pkt.length++] = data1;
+	q->pkt.data[q->pkt.length++] = data2;
+	q->messages++;
+}
+
+void _ls_queueExtButton(launchpad_t * l, size_t index, uint8_t color) {
+	const uint16_t btn = _ls_indexToExtButton(index);
+	_ls_queueMessage(l, btn >> 8, btn & 0x00ff, color);
+}
+
+// MK1 protocol: a steady colour (off included) is written to both buffers, whichever one is shown
+uint8_t _ls_mk1Velocity(uint8_t color) {
+	return LS_COLOR_IS_FLASHING(color) ? color : color | LS_COLOR_FLAGS_NORMAL;
+}
+
+// sends 1 message per changed LED, MK1 protocol
+size_t _ls_flushDiff(launchpad_t * l) {
+	size_t sent = 0;
+	
+	for (size_t i = 0; l->grid_dirty != 0 && i < LS_GRID_CELLS; i++) {
+		if (!(l->grid_dirty & (1ULL << i))) {
+			continue;
+		}
+		l->grid_dirty &= ~(1ULL << i);
+		
+		if (l->grid_leds[i] != l->grid_leds_shown[i]) {
+			_ls_queueMessage(l, kSLMIDIMessageType_NoteOn, LS_PKT_TO_GRID_POS(i % LS_COLS, i / LS_COLS), _ls_mk1Velocity(l->grid_leds[i]));
+			l->grid_leds_shown[i] = l->grid_leds[i];
+			sent++;
+		}
+	}
+	
+	for (size_t i = 0; l->ext_dirty != 0 && i < LS_EXT_BUTTONS; i++) {
+		if (!(l->ext_dirty & (1 << i))) {
+			continue;
+		}
+		l->ext_dirty &= ~(1 << i);
+		
+		if (l->ext_leds[i] != l->ext_leds_shown[i]) {
+			_ls_queueExtButton(l, i, _ls_mk1Velocity(l->ext_leds[i]));
+			l->ext_leds_shown[i] = l->ext_leds[i];
+			sent++;
+		}
+	}
+	
+	return sent;
+}
+
+// --- MK1 RENDERER ---
+
+void _ls_mk1SetBuffers(launchpad_t * l, uint8_t display, uint8_t update, bool copy, bool flash) {
+	_ls_queueMessage(l, kSLMIDIMessageType_ControlChange, LS_MK1_CC_BUFFERS, LS_MK1_BUFFERS(display, update, copy, flash));
+	l->mk1_display_buffer = display;
+	l->mk1_update_buffer = update;
+	l->mk1_flashing = flash;
+}
+
+size_t _ls_changedLeds(launchpad_t * l, bool * hasFlashing) {
+	size_t changed = 0;
+	*hasFlashing = false;
+	
+	for (size_t i = 0; i < LS_GRID_CELLS; i++) {
+		changed += l->grid_leds[i] != l->grid_leds_shown[i];
+		*hasFlashing |= LS_COLOR_IS_FLASHING(l->grid_leds[i]);
+	}
+	for (size_t i = 0; i < LS_EXT_BUTTONS; i++) {
+		changed += l->ext_leds[i] != l->ext_leds_shown[i];
+		*hasFlashing |= LS_COLOR_IS_FLASHING(l->ext_leds[i]);
+	}
+	
+	return changed;
+}
+
+// Rapid update order: 64 grid cells, 8 right column buttons then 8 top buttons
+uint8_t _ls_mk1RapidColor(launchpad_t * l, size_t rapidIndex) {
+	uint8_t color = LS_COLOR_NONE;
+	
+	if (rapidIndex < LS_GRID_CELLS) {
+		color = l->grid_leds[rapidIndex];
+	} else if (rapidIndex < LS_GRID_CELLS + 8) {
+		color = l->ext_leds[8 + rapidIndex - LS_GRID_CELLS];
+	} else {
+		color = l->ext_leds[rapidIndex - LS_GRID_CELLS - 8];
+	}
+	
+	// no flags: only written to the update (hidden) buffer
+	return color & LS_COLOR_MASK;
+}
+
+// draws the whole frame into the hidden buffer then shows it (no tearing)
+size_t _ls_mk1FlushFrame(launchpad_t * l, bool hasFlashing) {
+	const uint8_t hidden = !l->mk1_display_buffer;
+	size_t sent = 0;
+	
+	_ls_mk1SetBuffers(l, l->mk1_display_buffer, hidden, false, false);
+	// resets the rapid update cursor to the top left cell
+	_ls_queueMessage(l, kSLMIDIMessageType_ControlChange, LS_MK1_CC_GRID_MAPPING, 0x00);
+	
+	for (size_t i = 0; i < LS_GRID_CELLS + LS_EXT_BUTTONS; i += 2) {
+		_ls_queueMessage(l, LS_MK1_RAPID_UPDATE, _ls_mk1RapidColor(l, i), _ls_mk1RapidColor(l, i + 1));
+		sent += 2;
+	}
+	
+	// show the new frame, copy it to the other buffer and keep updating the shown one: a diff written next is seen
+	_ls_mk1SetBuffers(l, hidden, hidden, true, false);
+	
+	memcpy(l->grid_leds_shown, l->grid_leds, sizeof(l->grid_leds_shown));
+	memcpy(l->ext_leds_shown, l->ext_leds, sizeof(l->ext_leds_shown));
+	l->grid_dirty = 0;
+	l->ext_dirty = 0;
+	
+	if (hasFlashing) {
+		// flashing LEDs have to be cleared from one of the buffers
+		for (size_t i = 0; i < LS_GRID_CELLS; i++) {
+			if (LS_COLOR_IS_FLASHING(l->grid_leds[i])) {
+				_ls_queueMessage(l, kSLMIDIMessageType_NoteOn, LS_PKT_TO_GRID_POS(i % LS_COLS, i / LS_COLS), l->grid_leds[i]);
+			}
+		}
+		for (size_t i = 0; i < LS_EXT_BUTTONS; i++) {
+			if (LS_COLOR_IS_FLASHING(l->ext_leds[i])) {
+				_ls_queueExtButton(l, i, l->ext_leds[i]);
+			}
+		}
+		_ls_mk1SetBuffers(l, l->mk1_display_buffer, l->mk1_update_buffer, false, true);
+	}
+	
+	return sent;
+}
+
+size_t _ls_flushMK1(launchpad_t * l) {
+	if (l->grid_dirty == 0 && l->ext_dirty == 0) {
+		return 0;
+	}
+	
+	if (l->mk1_needs_reset) {
+		// everything off, buffer 0 displayed and updated, no flashing
+		_ls_queueMessage(l, kSLMIDIMessageType_ControlChange, LS_MK1_CC_BUFFERS, 0x00);
+		memset(l->grid_leds_shown, LS_COLOR_NONE, sizeof(l->grid_leds_shown));
+		memset(l->ext_leds_shown, LS_COLOR_NONE, sizeof(l->ext_leds_shown));
+		l->mk1_display_buffer = 0;
+		l->mk1_update_buffer = 0;
+		l->mk1_flashing = false;
+		l->mk1_needs_reset = false;
+	}
+	
+	bool hasFlashing = false;
+	const size_t changed = _ls_changedLeds(l, &hasFlashing);
+	
+	if (changed > LS_MK1_FULL_FRAME_THRESHOLD) {
+		return _ls_mk1FlushFrame(l, hasFlashing);
+	}
+	
+	const size_t sent = _ls_flushDiff(l);
+	// on with the first flashing LED, off once the last one is gone
+	if (hasFlashing != l->mk1_flashing) {
+		_ls_mk1SetBuffers(l, l->mk1_display_buffer, l->mk1_update_buffer, false, hasFlashing);
+	}
+	
+	return sent;
+}
+
+// --- MK2 / MK3 RENDERER ---
+
+// indexed by red level | green level << 2
+const ls_rgb_t ls_rgbPalette[16] = {
+	{  0,   0, 0,  0}, { 24,   0, 0,  7}, { 72,   0, 0,  6}, {127,   0, 0,  5},
+	{  0,  24, 0, 23}, { 24,  24, 0, 15}, { 72,  24, 0, 11}, {127,  24, 0, 60},
+	{  0,  72, 0, 22}, { 40,  72, 0, 19}, { 72,  72, 0, 14}, {127,  72, 0, 10},
+	{  0, 127, 0, 21}, { 64, 127, 0, 17}, {100, 127, 0, 13}, {127, 100, 0,  9}
+};
+
+const ls_rgb_t * _ls_rgbColor(uint8_t color) {
+	return &ls_rgbPalette[(color & 0x03) | ((color >> 2) & 0x0C)];
+}
+
+// origin is the bottom left pad (11), top row is 8x
+uint8_t _ls_rgbGridLed(size_t index) {
+	return (LS_ROWS - (index / LS_COLS)) * 10 + (index % LS_COLS) + 1;
+}
+
+uint8_t _ls_rgbExtLed(launchpad_t * l, size_t index) {
+	if (index < 8) {
+		return (l->version == kLaunchpadVersion_MK2 ? LS_MK2_TOP_ROW_FIRST : LS_MK3_TOP_ROW_FIRST) + index;
+	}
+	return (LS_ROWS - (index - 8)) * 10 + 9;
+}
+
+// reserves room for a whole message, a SysEx can't be split across packets
+void _ls_queueReserve(launchpad_t * l, size_t length) {
+	if (l->out_queue.pkt.length + length > SL_MIDI_PACKET_MAX_LENGTH) {
+		ls_midi_flushQueue(l);
+	}
+}
+
+void _ls_queueByte(launchpad_t * l, uint8_t value) {
+	l->out_queue.pkt.data[l->out_queue.pkt.length++] = value;
+}
+
+void _ls_queueSysexHeader(launchpad_t * l, uint8_t command) {
+	const uint8_t header[] = {kSLMIDIMessageType_System, LS_SYSEX_NOVATION_ID, 0x02, l->sysex_device_id, command};
+	
+	for (size_t i = 0; i < sizeof(header); i++) {
+		_ls_queueByte(l, header[i]);
+	}
+}
+
+void _ls_queueSysexEnd(launchpad_t * l) {
+	_ls_queueByte(l, kSLMIDIMessageType_SystemExclusiveEnd);
+	l->out_queue.messages++;
+}
+
+void _ls_queueRgbLed(launchpad_t * l, uint8_t led, uint8_t color) {
+	const ls_rgb_t * rgb = _ls_rgbColor(color);
+	
+	if (l->version == kLaunchpadVersion_MK2) {
+		_ls_queueByte(l, led);
+		_ls_queueByte(l, rgb->r >> 1);
+		_ls_queueByte(l, rgb->g >> 1);
+		_ls_queueByte(l, rgb->b >> 1);
+	} else if (LS_COLOR_IS_FLASHING(color)) {
+		_ls_queueByte(l, LS_SYSEX_MK3_LED_FLASHING);
+		_ls_queueByte(l, led);
+		_ls_queueByte(l, 0x00);
+		_ls_queueByte(l, rgb->palette);
+	} else {
+		_ls_queueByte(l, LS_SYSEX_MK3_LED_RGB);
+		_ls_queueByte(l, led);
+		_ls_queueByte(l, rgb->r);
+		_ls_queueByte(l, rgb->g);
+		_ls_queueByte(l, rgb->b);
+	}
+}
+
+void _ls_queueMK2Flash(launchpad_t * l, uint8_t led, uint8_t color) {
+	_ls_queueReserve(l, LS_SYSEX_HEADER_LENGTH + 3);
+	_ls_queueSysexHeader(l, LS_SYSEX_MK2_FLASH_LED);
+	_ls_queueByte(l, led);
+	_ls_queueByte(l, _ls_rgbColor(color)->palette);
+	_ls_queueSysexEnd(l);
+}
+
+// every changed LED goes in a single "set LEDs" SysEx
+size_t _ls_flushRGB(launchpad_t * l) {
+	if (l->grid_dirty == 0 && l->ext_dirty == 0) {
+		return 0;
+	}
+	
+	bool hasFlashing = false;
+	const size_t changed = _ls_changedLeds(l, &hasFlashing);
+	l->grid_dirty = 0;
+	l->ext_dirty = 0;
+	
+	if (changed == 0) {
+		return 0;
+	}
+	
+	_ls_queueReserve(l, LS_SYSEX_HEADER_LENGTH + changed * 5 + 1);
+	_ls_queueSysexHeader(l, l->version == kLaunchpadVersion_MK2 ? LS_SYSEX_MK2_SET_LEDS_RGB : LS_SYSEX_MK3_SET_LEDS);
+	for (size_t i = 0; i < LS_GRID_CELLS; i++) {
+		if (l->grid_leds[i] != l->grid_leds_shown[i]) {
+			_ls_queueRgbLed(l, _ls_rgbGridLed(i), l->grid_leds[i]);
+		}
+	}
+	for (size_t i = 0; i < LS_EXT_BUTTONS; i++) {
+		if (l->ext_leds[i] != l->ext_leds_shown[i]) {
+			_ls_queueRgbLed(l, _ls_rgbExtLed(l, i), l->ext_leds[i]);
+		}
+	}
+	_ls_queueSysexEnd(l);
+	
+	// MK2 can't flash from the RGB message
+	if (hasFlashing && l->version == kLaunchpadVersion_MK2) {
+		for (size_t i = 0; i < LS_GRID_CELLS; i++) {
+			if (l->grid_leds[i] != l->grid_leds_shown[i] && LS_COLOR_IS_FLASHING(l->grid_leds[i])) {
+				_ls_queueMK2Flash(l, _ls_rgbGridLed(i), l->grid_leds[i]);
+			}
+		}
+		for (size_t i = 0; i < LS_EXT_BUTTONS; i++) {
+			if (l->ext_leds[i] != l->ext_leds_shown[i] && LS_COLOR_IS_FLASHING(l->ext_leds[i])) {
+				_ls_queueMK2Flash(l, _ls_rgbExtLed(l, i), l->ext_leds[i]);
+			}
+		}
+	}
+	
+	memcpy(l->grid_leds_shown, l->grid_leds, sizeof(l->grid_leds_shown));
+	memcpy(l->ext_leds_shown, l->ext_leds, sizeof(l->ext_leds_shown));
+	
+	return changed;
+}
+
+size_t ls_flush(launchpad_t * l) {
+	size_t sent = 0;
+	const bool outer = in_rt_path;
+	
+	// also reached outside a frame (bench, host redraws)
+	in_rt_path = true;
+	switch (l->version) {
+		case kLaunchpadVersion_MK1:
+			sent = _ls_flushMK1(l);
+			break;
+		case kLaunchpadVersion_MK2:
+		case kLaunchpadVersion_MK3:
+			sent = _ls_flushRGB(l);
+			break;
+		default:
+			sent = _ls_flushDiff(l);
+			break;
+	}
+	
+	ls_midi_flushQueue(l);
+	
+	if (sent > 0) {
+		trace_write(l->trace, kTraceEvent_Flush, 0, 0, 0, (uint32_t)sent);
+	}
+	in_rt_path = outer;
+	
+	return sent;
+}
+
+void ls_invalidate(launchpad_t * l) {
+	memset(l->grid_leds_shown, LS_COLOR_UNKNOWN, sizeof(l->grid_leds_shown));
+	memset(l->ext_leds_shown, LS_COLOR_UNKNOWN, sizeof(l->ext_leds_shown));
+	l->grid_dirty = ~0ULL;
+	l->ext_dirty = 0xFFFF;
+	l->mk1_needs_reset = true;
+}
+
+// --- DEVICES ---
+
+void ls_setVersion(launchpad_t * l, LaunchpadVersion version, uint8_t sysexDeviceId) {
+	l->version = version;
+	l->sysex_device_id = sysexDeviceId;
+	
+	if (version == kLaunchpadVersion_MK3) {
+		// grid as notes 11-88, side buttons as CC
+		_ls_queueReserve(l, LS_SYSEX_HEADER_LENGTH + 2);
+		_ls_queueSysexHeader(l, LS_SYSEX_MK3_PROGRAMMER_MODE);
+		_ls_queueByte(l, 0x01);
+		_ls_queueSysexEnd(l);
+	}
+	
+	ls_invalidate(l);
+}
+
+void ls_requestVersion(launchpad_t * l) {
+	const uint8_t inquiry[] = {LS_INQUIRY_REQUEST};
+	
+	_ls_queueReserve(l, sizeof(inquiry));
+	for (size_t i = 0; i < sizeof(inquiry); i++) {
+		_ls_queueByte(l, inquiry[i]);
+	}
+	l->out_queue.messages++;
+	ls_midi_flushQueue(l);
+}
+
+// F0 7E <channel> 06 02 00 20 29 <family lsb> <family msb> ... F7, only from a Launchpad we know
+bool ls_processSysex(launchpad_t * l, SLMIDIPacket * packet) {
+	const uint8_t novation[] = {LS_SYSEX_NOVATION_ID};
+	
+	if (packet->length < 10 || packet->data[0] != kSLMIDIMessageType_System
+		|| packet->data[1] != 0x7E || packet->data[3] != 0x06 || packet->data[4] != 0x02
+		|| memcmp(&packet->data[5], novation, sizeof(novation)) != 0) {
+		return false;
+	}
+	
+	const uint16_t family = packet->data[8] << 8 | packet->data[9];
+	
+	switch (family) {
+		case LS_INQUIRY_FAMILY_MK2:
+			ls_setVersion(l, kLaunchpadVersion_MK2, LS_SYSEX_DEVICE_MK2);
+			return true;
+		case LS_INQUIRY_FAMILY_MK3_MINI:
+			ls_setVersion(l, kLaunchpadVersion_MK3, LS_SYSEX_DEVICE_MK3_MINI);
+			return true;
+		case LS_INQUIRY_FAMILY_MK3_X:
+			ls_setVersion(l, kLaunchpadVersion_MK3, LS_SYSEX_DEVICE_MK3_X);
+			return true;
+		case LS_INQUIRY_FAMILY_MK3_PRO:
+			ls_setVersion(l, kLaunchpadVersion_MK3, LS_SYSEX_DEVICE_MK3_PRO);
+			return true;
+		default:
+			// Launchpad S & co speak the MK1 protocol, other Novation gear is not ours
+			return false;
+	}
+}
+
+void ls_translateInput(launchpad_t * l, SLMIDIPacket * packet) {
+	if (l->version == kLaunchpadVersion_MK1 || packet->length < 3) {
+		return;
+	}
+	
+	const SLMIDIMessageType type = packet->data[0] & 0xF0;
+	const uint8_t number = packet->data[1];
+	const uint8_t row = number / 10;
+	const uint8_t col = number % 10;
+	
+	if (type == kSLMIDIMessageType_NoteOff) {
+		packet->data[0] = kSLMIDIMessageType_NoteOn;
+		packet->data[2] = 0x00;
+	}
+	
+	if (type == kSLMIDIMessageType_ControlChange && l->version == kLaunchpadVersion_MK3
+		&& number >= LS_MK3_TOP_ROW_FIRST && number < LS_MK3_TOP_ROW_FIRST + 8) {
+		packet->data[1] = (LS_BT_TOP_ROW_FIRST & 0xff) + (number - LS_MK3_TOP_ROW_FIRST);
+	} else if (type == kSLMIDIMessageType_ControlChange && l->version == kLaunchpadVersion_MK2) {
+		// top row already matches MK1
+	} else if (row >= 1 && row <= LS_ROWS && col == 9) {
+		// side buttons, MK3 sends them as CC
+		packet->data[0] = kSLMIDIMessageType_NoteOn;
+		packet->data[1] = (LS_BT_OUT_COL_FIRST & 0xff) | ((LS_ROWS - row) << 4);
+	} else if (type != kSLMIDIMessageType_ControlChange && row >= 1 && row <= LS_ROWS && col >= 1 && col <= LS_COLS) {
+		packet->data[1] = LS_PKT_TO_GRID_POS(col - 1, LS_ROWS - row);
+	}
 }
 
 uint16_t ls_btnMapValue(SLMIDIPacket *packet) {
@@ -87,6 +579,31 @@ void ls_updateRow(launchpad_t * l, uint8_t rowIndex) {
 	}
 }
 
+uint8_t _ls_laneColor(StepLane lane) {
+	switch (lane) {
+		case kStepLane_Velocity:
+			return LS_COLOR_GREEN;
+		case kStepLane_Probability:
+			return LS_COLOR_AMBER;
+		case kStepLane_Ratchet:
+			return LS_COLOR_RED;
+		case kStepLane_Offset:
+			return LS_COLOR_YELLOW;
+		default:
+			return LS_COLOR_NONE;
+	}
+}
+
+void ls_updateColumn(launchpad_t * l, uint8_t columnIndex) {
+	if (columnIndex >= LS_COLS) {
+		return;
+	}
+	
+	for(size_t y = 0; y < LS_ROWS; y++) {
+		ls_updateCell(l, columnIndex, y);
+	}
+}
+
 void ls_clearOutCol(launchpad_t * l) {
 	for (size_t i = 0; i < N_TRIGGERS; i++) {
 		uint16_t baseValue = LS_BT_VOL | ((i << 4) & 0xf0);
@@ -123,7 +640,7 @@ void ls_editOutSub(launchpad_t * l) {
 
 void ls_muteOutSub(launchpad_t * l) {
 	if (l->sequence_view_mode == kLaunchpadSequenceViewMode_Paginated) {
-		//	step_sequence_t * cs = &l->sequencer->sequences[l->current_sequence_index];
+		//	step_sequence_t * cs = sequencer_getSequence(l->sequencer, l->current_sequence_index);
 		for (size_t i = 0; i < N_TRIGGERS; i++) {
 			uint16_t baseValue = LS_BT_VOL | ((i << 4) & 0xf0);
 			uint8_t color = 0x1C;
@@ -146,6 +663,22 @@ void ls_muteOutSub(launchpad_t * l) {
 	}
 }
 
+void ls_laneOutSub(launchpad_t * l) {
+	// the trigger whose lane is shown, whatever the sequence view mode
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		uint16_t btn = LS_BT_VOL | ((i << 4) & 0xf0);
+		uint8_t color = LS_COLOR_NONE;
+		
+		if (l->trigger_index == i) {
+			color = LS_COLOR_GREEN;
+		} else if (l->sequencer->triggers[i]) {
+			color = LS_COLOR_LOW_GREEN;
+		}
+		
+		ls_setExtButton(l, btn, color);
+	}
+}
+
 //TODO: redo logic
 void ls_updateOutColumn(launchpad_t * l) {
 	switch(l->current_view_mode) {
@@ -158,6 +691,9 @@ void ls_updateOutColumn(launchpad_t * l) {
 		case kLaunchpadViewMode_Sequence:
 			ls_editOutSub(l);
 			break;
+		case kLaunchpadViewMode_Lanes:
+			ls_laneOutSub(l);
+			break;
 		case kLaunchpadViewMode_Settings:
 			ls_clearOutCol(l);
 			break;
@@ -178,12 +714,19 @@ void ls_updateFnButtons(launchpad_t * l) {
 		case kLaunchpadViewMode_Sequence:
 			ls_setExtButton(l, LS_BT_MODE, LS_COLOR_RED);
 			break;
+		case kLaunchpadViewMode_Lanes:
+			ls_setExtButton(l, LS_BT_MODE, LS_COLOR_YELLOW);
+			break;
 		case kLaunchpadViewMode_Settings:
 			ls_setExtButton(l, LS_BT_MODE, LS_COLOR_NONE);
 			break;
 		default:
 			break;
 	}
+	// up / down pick the lane, lit in its colour
+	const uint8_t laneColor = l->current_view_mode == kLaunchpadViewMode_Lanes ? _ls_laneColor(l->lane_index) : LS_COLOR_NONE;
+	ls_setExtButton(l, LS_BT_UP_ARROW, laneColor);
+	ls_setExtButton(l, LS_BT_DOWN_ARROW, laneColor);
 	if (l->page_index == 0) {
 		//LS_BT_RIGHT_ARROW --> color green
 		//LS_BT_LEFT_ARROW --> color none
@@ -193,12 +736,12 @@ void ls_updateFnButtons(launchpad_t * l) {
 	}
 }
 
-SLMIDIPacket * _createPacket_updateCellPaginated(launchpad_t * l, uint8_t x, uint8_t y) {
-	SLMIDIPacket * result = NULL;
+bool _ls_cellColorPaginated(launchpad_t * l, uint8_t x, uint8_t y, uint8_t * result) {
+	bool created = false;
 	
 	uint8_t color = LS_COLOR_NONE;
 	const step_sequencer_t * sequencer = l->sequencer;
-	const step_sequence_t * cs = &sequencer->sequences[l->current_sequence_index];
+	const step_sequence_t * cs = sequencer_getSequence(l->sequencer, l->current_sequence_index);
 	const uint8_t patternIndex = y;
 	const step_pattern_t * pattern = &cs->patterns[patternIndex];
 	const bool isPlayingSequenceDisplayed = l->current_sequence_index == sequencer->current_sequence_index && sequencer->current_state == kSequencerState_Playing;
@@ -209,7 +752,7 @@ SLMIDIPacket * _createPacket_updateCellPaginated(launchpad_t * l, uint8_t x, uin
 	
 	//let's check if we are in range first
 	if (stepIndex >= (l->page_index * LS_MAX_STEPS_PER_ROW) && stepIndex < LS_MAX_STEPS_PER_ROW + (l->page_index * LS_MAX_STEPS_PER_ROW)) {
-		const uint8_t stepValue = pattern->steps[stepIndex];
+		const uint8_t stepValue = pattern_getStep(pattern, stepIndex);
 		//are we in range of last step ?
 		if (stepIndex < cs->last_step_indexes[patternIndex]) {
 			if (isPlayingSequenceDisplayed && stepIndex == cs->current_step_indexes[patternIndex]) {
@@ -230,23 +773,20 @@ SLMIDIPacket * _createPacket_updateCellPaginated(launchpad_t * l, uint8_t x, uin
 			}
 		}
 		
-		result = (SLMIDIPacket *)malloc(sizeof(SLMIDIPacket));
-		result->length = 3;
-		result->data[0] = kSLMIDIMessageType_NoteOn;
-		result->data[1] = LS_PKT_TO_GRID_POS(x % LS_MAX_STEPS_PER_ROW, y);
-		result->data[2] = color;
+		*result = color;
+		created = true;
 	}
 	
-	return result;
+	return created;
 }
 
 //TODO: updated assignation from ls button in main.c
-SLMIDIPacket * _createPacket_updateCellGrid(launchpad_t * l, uint8_t x, uint8_t y) {
-	SLMIDIPacket * result = NULL;
+bool _ls_cellColorGrid(launchpad_t * l, uint8_t x, uint8_t y, uint8_t * result) {
+	bool created = false;
 	
 	uint8_t color = LS_COLOR_NONE;
 	const step_sequencer_t * sequencer = l->sequencer;
-	const step_sequence_t * cs = &sequencer->sequences[l->current_sequence_index];
+	const step_sequence_t * cs = sequencer_getSequence(l->sequencer, l->current_sequence_index);
 	const uint8_t patternIndex = l->trigger_index;
 	const step_pattern_t * pattern = &cs->patterns[patternIndex];
 	const bool isPlayingSequenceDisplayed = l->current_sequence_index == sequencer->current_sequence_index && sequencer->current_state == kSequencerState_Playing;
@@ -254,7 +794,7 @@ SLMIDIPacket * _createPacket_updateCellGrid(launchpad_t * l, uint8_t x, uint8_t
 	const uint8_t lastStepIndex = cs->last_step_indexes[patternIndex];
 	
 	if (stepIndex < LS_ROWS * LS_COLS && stepIndex < MAX_STEPS) {
-		const uint8_t stepValue = pattern->steps[stepIndex];
+		const uint8_t stepValue = pattern_getStep(pattern, stepIndex);
 		if (isPlayingSequenceDisplayed && stepIndex == cs->current_step_indexes[patternIndex]) {
 			color = LS_COLOR_AMBER;
 		} else {
@@ -273,15 +813,44 @@ SLMIDIPacket * _createPacket_updateCellGrid(launchpad_t * l, uint8_t x, uint8_t
 			}
 		}
 		
-		result = (SLMIDIPacket *)malloc(sizeof(SLMIDIPacket));
-		result->length = 3;
-		result->data[0] = kSLMIDIMessageType_NoteOn;
-		result->data[1] = LS_PKT_TO_GRID_POS(x, y);
-		result->data[2] = color;
+		*result = color;
+		created = true;
 	}
 	
+	return created;
+}
+
+// column x: a step of the page, bottom row y = 7: level 1
+bool _ls_cellColorLanes(launchpad_t * l, uint8_t x, uint8_t y, uint8_t * result) {
+	uint8_t color = LS_COLOR_NONE;
+	const step_sequencer_t * sequencer = l->sequencer;
+	const step_sequence_t * cs = sequencer_getSequence(l->sequencer, l->current_sequence_index);
+	const uint8_t patternIndex = l->trigger_index;
+	const uint8_t stepIndex = x + (l->page_index * LS_MAX_STEPS_PER_ROW);
+	const bool isPlayingSequenceDisplayed = l->current_sequence_index == sequencer->current_sequence_index && sequencer->current_state == kSequencerState_Playing;
 	
-	return result;
+	if (stepIndex >= MAX_STEPS || y >= LANE_LEVELS) {
+		return false;
+	}
+	
+	if (stepIndex < cs->last_step_indexes[patternIndex]) {
+		const uint8_t level = lanes_toLevel(l->lane_index, seq_getLaneValue(cs, patternIndex, l->lane_index, stepIndex));
+		
+		if (LANE_LEVELS - y <= level) {
+			if (isPlayingSequenceDisplayed && stepIndex == cs->current_step_indexes[patternIndex]) {
+				color = LS_COLOR_AMBER;
+			} else if (IS_HIGH(pattern_getStep(&cs->patterns[patternIndex], stepIndex))) {
+				color = _ls_laneColor(l->lane_index);
+			} else {
+				// value kept for when the gate comes back
+				color = LS_COLOR_LOW_RED;
+			}
+		}
+	}
+	
+	*result = color;
+	
+	return true;
 }
 
 //TODO: update with mode
@@ -299,24 +868,27 @@ void ls_updateCell(launchpad_t * l, uint8_t x, uint8_t y) {
 	}
 	
 	const LaunchpadViewMode currentViewMode = l->current_view_mode;
-	SLMIDIPacket * pkt = NULL;
+	uint8_t color = LS_COLOR_NONE;													// no packet: ls_setGridButton queues the note on
+	bool created = false;
 	
 	switch(currentViewMode) {
 		case kLaunchpadViewMode_Pattern:
 		case kLaunchpadViewMode_Mute:
 			if (l->sequence_view_mode == kLaunchpadSequenceViewMode_Paginated) {
-				pkt = _createPacket_updateCellPaginated(l, x, y);
+				created = _ls_cellColorPaginated(l, x, y, &color);
 			} else if (l->sequence_view_mode == kLaunchpadSequenceViewMode_Grid) {
-				pkt = _createPacket_updateCellGrid(l, x, y);
+				created = _ls_cellColorGrid(l, x, y, &color);
 			}
 			break;
+		case kLaunchpadViewMode_Lanes:
+			created = _ls_cellColorLanes(l, x, y, &color);
+			break;
 		default:
 			break;
 	}
 	
-	if (pkt != NULL) {
-		ls_midi_send(l, pkt, 0);
-		free(pkt);
+	if (created) {
+		ls_setGridButton(l, x, y, color);
 	}
 }
 
@@ -327,6 +899,7 @@ void ls_updateGrid(launchpad_t * l) {
 	switch (l->current_view_mode) {
 		case kLaunchpadViewMode_Pattern:
 		case kLaunchpadViewMode_Mute:
+		case kLaunchpadViewMode_Lanes:
 			for (size_t y = 0; y < LS_ROWS; y++) {
 				for (size_t x = 0; x < LS_COLS; x++) {
 					ls_updateCell(l, x, y);
@@ -336,7 +909,7 @@ void ls_updateGrid(launchpad_t * l) {
 		case kLaunchpadViewMode_Sequence:
 			for (size_t i = 0; i < N_SEQUENCES; i++) {
 				int y = (int)(i / 4);
-				uint8_t color = seq_isEmpty(&l->sequencer->sequences[i]) ? LS_COLOR_LOW_RED : LS_COLOR_LOW_RED;
+				uint8_t color = seq_isEmpty(sequencer_getSequence(l->sequencer, i)) ? LS_COLOR_NONE : LS_COLOR_LOW_RED;
 				
 				if (i == sequencer_getCurrentSequenceIndex(l->sequencer)) {
 					//currently playing
@@ -345,10 +918,10 @@ void ls_updateGrid(launchpad_t * l) {
 						
 					}
 				} else if (l->sequencer->next_sequence_index != NO_NEXT_SEQUENCE && i == l->sequencer->next_sequence_index) {
-					//blink ?
-					color = LS_COLOR_LOW_GREEN;
+					//blink (done by the device)
+					color = LS_COLOR_FLASH(LS_COLOR_LOW_GREEN);
 					if (l->current_sequence_index == i) {
-						color = LS_COLOR_GREEN;
+						color = LS_COLOR_FLASH(LS_COLOR_GREEN);
 					}
 				} else if (l->current_sequence_index == i) {
 					//currently viewing
@@ -382,18 +955,54 @@ void ls_setSequenceViewMode(launchpad_t * l, LaunchpadSequenceViewMode newMode)
 }
 
 void ls_updateLastStepIndex(launchpad_t * l, uint8_t x, uint8_t y) {
+	uint8_t patternIndex = l->trigger_index;
+	uint8_t index = (x  + 1) + LS_MAX_STEPS_PER_ROW * y;
+	
 	if (l->sequence_view_mode == kLaunchpadSequenceViewMode_Paginated) {
-		seq_setLastStepIndex(ls_getCurrentSequence(l), y, x + (l->page_index * LS_MAX_STEPS_PER_ROW) + 1);
+		patternIndex = y;
+		index = x + (l->page_index * LS_MAX_STEPS_PER_ROW) + 1;
+	}
+	
+	if (l->edits != NULL) {
+		edits_push(l->edits, 0, kEditCommand_SetLastStep, l->current_sequence_index, patternIndex, index);
 	} else {
-		seq_setLastStepIndex(ls_getCurrentSequence(l), l->trigger_index, ((x  + 1) + LS_MAX_STEPS_PER_ROW * y));
+		sequencer_setLastStepIndex(l->sequencer, l->current_sequence_index, patternIndex, index);
 	}
 }
 
 void ls_toggleStep(launchpad_t * l, uint8_t x, uint8_t y) {
+	uint8_t patternIndex = l->trigger_index;
+	uint8_t stepIndex = x + LS_MAX_STEPS_PER_ROW * y;
+	
 	if (l->sequence_view_mode == kLaunchpadSequenceViewMode_Paginated) {
-		seq_togglePatternStepValue(ls_getCurrentSequence(l), y, x + (l->page_index * LS_MAX_STEPS_PER_ROW));
+		patternIndex = y;
+		stepIndex = x + (l->page_index * LS_MAX_STEPS_PER_ROW);
+	}
+	
+	if (l->edits != NULL) {
+		edits_push(l->edits, 0, kEditCommand_ToggleStep, l->current_sequence_index, patternIndex, stepIndex);
+	} else {
+		sequencer_togglePatternStepValue(l->sequencer, l->current_sequence_index, patternIndex, stepIndex);
+	}
+}
+
+void ls_incrLaneIndex(launchpad_t * l, int8_t value) {
+	l->lane_index = (StepLane)utils_circularLoopGetIndex(l->lane_index, value, kStepLane_Count);
+	ls_updateDisplay(l);
+}
+
+void ls_setLaneStep(launchpad_t * l, uint8_t x, uint8_t y, bool reset) {
+	const uint8_t stepIndex = x + (l->page_index * LS_MAX_STEPS_PER_ROW);
+	const int value = reset ? lanes_default(l->lane_index) : lanes_fromLevel(l->lane_index, LANE_LEVELS - y);
+	
+	if (stepIndex >= MAX_STEPS || y >= LANE_LEVELS) {
+		return;
+	}
+	
+	if (l->edits != NULL) {
+		edits_push(l->edits, 0, kEditCommand_SetLaneValue, l->current_sequence_index, l->trigger_index, EDITS_LANE_VALUE(stepIndex, l->lane_index, value));
 	} else {
-		seq_togglePatternStepValue(ls_getCurrentSequence(l), l->trigger_index, x + LS_MAX_STEPS_PER_ROW * y);
+		sequencer_setLaneValue(l->sequencer, l->current_sequence_index, l->trigger_index, l->lane_index, stepIndex, value);
 	}
 }
 
@@ -402,6 +1011,6 @@ step_sequence_t * ls_getCurrentSequence(launchpad_t * l) {
 		return NULL;
 	}
 	
-	return &l->sequencer->sequences[l->current_sequence_index];
+	return sequencer_getSequence(l->sequencer, l->current_sequence_index);
 
 }
@@ -10,9 +10,12 @@
 
 #include "launchpad_defs.h"
 #include "midi.h"
+#include "lanes.h"
 
 typedef struct step_sequencer_t step_sequencer_t;
 typedef struct step_sequence_t step_sequence_t;
+typedef struct edit_queue_t edit_queue_t;
+typedef struct trace_ring_t trace_ring_t;
 
 #define IS_HIGH(value)          value > 0
 
@@ -21,7 +24,8 @@ typedef enum LaunchpadViewMode {
 	kLaunchpadViewMode_Pattern = 0,
 	kLaunchpadViewMode_Mute = 1,
 	kLaunchpadViewMode_Sequence = 2,
-	kLaunchpadViewMode_Settings = 3
+	kLaunchpadViewMode_Lanes = 3,				// one step per column, its lane value as a bar
+	kLaunchpadViewMode_Settings = 4
 } LaunchpadViewMode;
 
 typedef enum LaunchpadSequenceViewMode {
@@ -35,35 +39,87 @@ typedef enum LaunchpadVersion {
 	kLaunchpadVersion_MK3 = 3
 } LaunchpadVersion;
 
+// Outgoing messages of one tick / input event, sent to midi_snd_cb as a single packet
+typedef struct ls_midi_queue_t {
+	SLMIDIPacket				pkt;
+	uint16_t					messages;
+	
+	// stats of the last flush
+	uint16_t					flushed_messages;
+	uint16_t					flushed_bytes;
+} ls_midi_queue_t;
+
+// MK1 red/green levels to RGB devices
+typedef struct ls_rgb_t {
+	uint8_t						r;											// 0-127
+	uint8_t						g;
+	uint8_t						b;
+	uint8_t						palette;									// used for flashing LEDs
+} ls_rgb_t;
+
 typedef struct launchpad_t {
 	uint8_t 					page_index;
 	uint8_t						trigger_index;
+	StepLane					lane_index;									// edited in kLaunchpadViewMode_Lanes
 	bool						shift_btn_hold;
 	bool						clear_btn_hold;
 	step_sequencer_t *			sequencer;
+	edit_queue_t *				edits;										// edits go through it when set (applied by the clock)
+	trace_ring_t *				trace;										// flush records when set
 	LaunchpadViewMode           current_view_mode;
 	LaunchpadSequenceViewMode	sequence_view_mode;
 	uint8_t						current_sequence_index;
 	bool						auto_follow_sequence;
+	LaunchpadVersion			version;
+	uint8_t						sysex_device_id;							// MK2 / MK3 only
 	
-	void 						(*midi_snd_cb)(SLMIDIPacket * pkt, uint8_t channel);
-	void 						(*midi_rcv_cb)(SLMIDIPacket * pkt);
+	// MK1 device state
+	uint8_t						mk1_display_buffer;
+	uint8_t						mk1_update_buffer;
+	bool						mk1_flashing;
+	bool						mk1_needs_reset;
+	
+	// Shadow framebuffer: setters only write here, ls_flush() sends the cells that differ from what the device shows
+	uint8_t						grid_leds[LS_GRID_CELLS];
+	uint8_t						grid_leds_shown[LS_GRID_CELLS];
+	uint8_t						ext_leds[LS_EXT_BUTTONS];
+	uint8_t						ext_leds_shown[LS_EXT_BUTTONS];
+	uint64_t					grid_dirty;									// 1 bit per grid cell
+	uint16_t					ext_dirty;									// 1 bit per ext button
+	ls_midi_queue_t				out_queue;
+	
+	void 						(*midi_snd_cb)(void * ctx, SLMIDIPacket * pkt, uint8_t channel);
+	void 						(*midi_rcv_cb)(void * ctx, SLMIDIPacket * pkt);
+	void *						ctx;										// given to both, one per device
 } launchpad_t;
 
 void 						ls_init(launchpad_t * l, step_sequencer_t * seq);
 void 						ls_updateDisplay(launchpad_t * l);
-void 						ls_updateCell(launchpad_t * l, uint8_t x, uint8_t y);						//sends 1 MIDI messages
-void 						ls_updateRow(launchpad_t * l, uint8_t rowIndex);							//sends 8 MIDI messages
-void 						ls_updateGrid(launchpad_t * l);												//sends 64 MIDI messages
-void 						ls_updateFnButtons(launchpad_t * l);										//sends 8 MIDI messages
-void 						ls_updateOutColumn(launchpad_t * l);										//sends 8 MIDI messages
-void 						ls_setExtButton(launchpad_t * l, uint16_t btnIndex, uint8_t color);			//sends 1 MIDI messages
-void 						ls_setGridButton(launchpad_t * l, uint8_t x, uint8_t y, uint8_t color);		//sends 1 MIDI messages
+void 						ls_updateCell(launchpad_t * l, uint8_t x, uint8_t y);						//updates 1 shadow cell
+void 						ls_updateRow(launchpad_t * l, uint8_t rowIndex);							//updates 8 shadow cells
+void 						ls_updateColumn(launchpad_t * l, uint8_t columnIndex);						//updates 8 shadow cells
+void 						ls_updateGrid(launchpad_t * l);												//updates 64 shadow cells
+void 						ls_updateFnButtons(launchpad_t * l);										//updates 8 shadow buttons
+void 						ls_updateOutColumn(launchpad_t * l);										//updates 8 shadow buttons
+void 						ls_setExtButton(launchpad_t * l, uint16_t btnIndex, uint8_t color);			//updates 1 shadow button
+void 						ls_setGridButton(launchpad_t * l, uint8_t x, uint8_t y, uint8_t color);		//updates 1 shadow cell
+size_t 						ls_flush(launchpad_t * l);													//sends 1 MIDI message per changed LED
+void 						ls_invalidate(launchpad_t * l);												//next flush resends every LED
+void 						ls_midi_send(launchpad_t * l, SLMIDIPacket * pkt, uint8_t channel);			//queues pkt until ls_midi_flushQueue
+size_t 						ls_midi_flushQueue(launchpad_t * l);										//sends queued messages in one packet
 void						ls_setCurrentSequenceIndex(launchpad_t * l, uint8_t sequenceIndex);
 void 						ls_incrPageIndex(launchpad_t * l, int8_t value);
 void 						ls_setSequenceViewMode(launchpad_t * l, LaunchpadSequenceViewMode newMode);
 void 						ls_updateLastStepIndex(launchpad_t * l, uint8_t x, uint8_t y);
 void 						ls_toggleStep(launchpad_t * l, uint8_t x, uint8_t y);
+void 						ls_incrLaneIndex(launchpad_t * l, int8_t value);
+void 						ls_setLaneStep(launchpad_t * l, uint8_t x, uint8_t y, bool reset);			//column x to the level of row y, or back to the default
+
+// Devices
+void 						ls_setVersion(launchpad_t * l, LaunchpadVersion version, uint8_t sysexDeviceId);
+void 						ls_requestVersion(launchpad_t * l);											//sends a device inquiry
+bool 						ls_processSysex(launchpad_t * l, SLMIDIPacket * packet);					//a Launchpad inquiry reply: version set, true
+void 						ls_translateInput(launchpad_t * l, SLMIDIPacket * packet);					//MK2 / MK3 buttons to MK1 mapping
 
 // Utilities
 step_sequence_t * 			ls_getCurrentSequence(launchpad_t * l);
@@ -11,6 +11,8 @@
 #define LS_ROWS								8
 #define LS_COLS								8
 #define LS_MAX_STEPS_PER_ROW				LS_COLS
+#define LS_GRID_CELLS						(LS_ROWS * LS_COLS)
+#define LS_EXT_BUTTONS						16							// 8 top CC buttons + 8 right column note buttons
 #define LS_COLOR_NONE						0x00
 #define LS_COLOR_RED						0x0F
 #define LS_COLOR_LOW_RED					0x0D
@@ -19,8 +21,46 @@
 #define LS_COLOR_AMBER						0x3F
 #define LS_COLOR_YELLOW						0x3E
 #define LS_COLOR_LOW_YELLOW					0x3E
+#define LS_COLOR_MASK						0x33						// red (bits 0-1) & green (bits 4-5) without MK1 flags
+#define LS_COLOR_FLAGS_NORMAL				0x0C						// MK1: copy + clear, write both buffers
+#define LS_COLOR_FLAGS_FLASH				0x08						// MK1: clear only, LED blinks when flashing is on
+#define LS_COLOR_FLASH(color)				(((color) & LS_COLOR_MASK) | LS_COLOR_FLAGS_FLASH)
+#define LS_COLOR_IS_FLASHING(color)			((color) != LS_COLOR_UNKNOWN && ((color) & LS_COLOR_FLAGS_NORMAL) == LS_COLOR_FLAGS_FLASH)
+#define LS_COLOR_UNKNOWN					0xFF						// not a valid velocity, forces a resend on next flush
 
 
+//MK1 protocol
+
+#define LS_MK1_RAPID_UPDATE					0x92						// NoteOn channel 3, 2 LEDs per message
+#define LS_MK1_CC_BUFFERS					0x00
+#define LS_MK1_CC_GRID_MAPPING				0x01
+#define LS_MK1_BUFFERS(display, update, copy, flash)	(0x20 | ((copy) << 4) | ((flash) << 3) | ((update) << 2) | (display))
+#define LS_MK1_FULL_FRAME_THRESHOLD			((LS_GRID_CELLS + LS_EXT_BUTTONS) / 2 + 3)	// rapid frame + buffer messages
+
+//MK2 / MK3 protocol (SysEx)
+
+#define LS_SYSEX_NOVATION_ID				0x00, 0x20, 0x29
+#define LS_SYSEX_HEADER_LENGTH				7							// F0 00 20 29 02 <device> <command>
+#define LS_SYSEX_DEVICE_MK2					0x18
+#define LS_SYSEX_DEVICE_MK3_PRO				0x0E
+#define LS_SYSEX_DEVICE_MK3_MINI			0x0D
+#define LS_SYSEX_DEVICE_MK3_X				0x0C
+#define LS_SYSEX_MK2_SET_LEDS_RGB			0x0B						// <led> <r> <g> <b>, 0-63
+#define LS_SYSEX_MK2_FLASH_LED				0x23						// <led> <palette>
+#define LS_SYSEX_MK3_SET_LEDS				0x03						// <type> <led> <data...>
+#define LS_SYSEX_MK3_PROGRAMMER_MODE		0x0E
+#define LS_SYSEX_MK3_LED_FLASHING			0x01						// <palette B> <palette A>
+#define LS_SYSEX_MK3_LED_RGB				0x03						// <r> <g> <b>, 0-127
+#define LS_MK2_TOP_ROW_FIRST				104							// CC
+#define LS_MK3_TOP_ROW_FIRST				91							// CC
+
+//Universal device inquiry
+#define LS_INQUIRY_REQUEST					0xF0, 0x7E, 0x7F, 0x06, 0x01, 0xF7
+#define LS_INQUIRY_FAMILY_MK2				0x6900
+#define LS_INQUIRY_FAMILY_MK3_MINI			0x1301
+#define LS_INQUIRY_FAMILY_MK3_X				0x0301
+#define LS_INQUIRY_FAMILY_MK3_PRO			0x2301
+
 //LS button mapping
 
 #define LS_BT_UP_ARROW						0xB068
@@ -41,12 +81,17 @@
 #define LS_BT_SOLO							0x9068
 #define LS_BT_ARM							0x9078
 
+#define LS_BT_TOP_ROW_FIRST					LS_BT_UP_ARROW
+#define LS_BT_OUT_COL_FIRST					LS_BT_VOL
+
 #define LS_BT_SHIFT							LS_BT_MIXER
 #define LS_BT_CLEAR							LS_BT_USER2
 #define LS_BT_MODE							LS_BT_SESSION
 #define LS_BT_RESET							LS_BT_USER1
+#define LS_BT_UNDO							LS_BT_LEFT_ARROW				// with shift
+#define LS_BT_REDO							LS_BT_RIGHT_ARROW				// with shift
 
-#define LS_PKT_TO_GRID_POS(x,y)				x + (y * 16)
-#define LS_BT_CONVERT(b1, b2)				b1 << 8 | b2
+#define LS_PKT_TO_GRID_POS(x,y)				((x) + ((y) * 16))
+#define LS_BT_CONVERT(b1, b2)				((b1) << 8 | (b2))
 
 #endif /* launchpad_defs_h */
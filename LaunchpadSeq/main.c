@@ -7,140 +7,60 @@
 
 #include <CoreMIDI/MIDIServices.h>
 #include <CoreFoundation/CFRunLoop.h>
+#include <dispatch/dispatch.h>
 
 #include <stdio.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include "launchpad.h"
-#include "sequencer.h"
-#include "utils.h"
-//#include "preset.h"
-
-#define DEBUG						0
-
-#define DEFAUTL_MIDI_IN_CHANNEL     1
-#define DEFAUTL_MIDI_OUT_CHANNEL    2
-
-#define CLOCK_IN_PIN                2
-#define CLOCK_OUT_PIN               3
-#define RESET_PIN                   4
-#define DIR_PIN    		            5
-
-// PINS DEFINITIONS
-const uint8_t              	outputs[N_TRIGGERS] = {
-	30,31,32,33,
-	34,35,36,37
-};
-
+#include <string.h>
+#include "app.h"
+#include "preset.h"
+
+#define DEFAUTL_MIDI_CLOCK_OUT_DEST	1											// destination 0 is the Launchpad
+#define LAUNCHPAD_NAME				"Launchpad"
+
+// one per Launchpad found, bound to its own instance
+typedef struct launchpad_device_t {
+	MIDIEndpointRef				dest;
+	MIDIEntityRef				entity;											// its sources belong to the same entity
+	app_instance_t *			instance;
+} launchpad_device_t;
+
+app_t						app;
+launchpad_device_t			devices[APP_MAX_INSTANCES];
+size_t						device_count = 0;
 MIDIPortRef     			gOutPort = NULL;
-MIDIEndpointRef 			gDest = NULL;
-
-// MIDI
-uint8_t                     midi_mapping_offset = 0;                        //ROM
-uint8_t                     midi_out_channel = DEFAUTL_MIDI_OUT_CHANNEL;     //ROM
-uint8_t                     midi_in_channel = DEFAUTL_MIDI_IN_CHANNEL;     //ROM
-
-launchpad_t					ls;
-step_sequencer_t			sequencer;
-
-void wrap_sq_updateTriggers(void * s);
-void wrap_sq_updateTrigger(void * s, uint8_t triggerIndex);
-void wrap_sq_updateMutedTriggers(void *s, uint8_t triggerIndex);
-void wrap_sq_updatePattern(void *s, uint8_t sequenceIndex, uint8_t pI);
-void wrap_sq_updateStep(void * s, uint8_t sequenceIndex, uint8_t pI, uint8_t sI);
-void wrap_sq_updateState(void * s);
-void wrap_sq_updateSequenceIndex(void * s, uint8_t sequenceIndex);
-void wrap_sq_updateNextSequenceIndex(void * s);
+MIDIEndpointRef 			gClockDest = NULL;
+preset_file_t				banks[APP_MAX_INSTANCES];							// argv[1 + n]: bank of Launchpad n
 
-void wrap_ls_midi_snd(SLMIDIPacket * pkt, uint8_t channel);
-void wrap_ls_midi_rcv(SLMIDIPacket * pkt);
+uint8_t                     midi_clock_out_dest = DEFAUTL_MIDI_CLOCK_OUT_DEST;     //ROM
 
-bool processFunButton(SLMIDIPacket *packet);
-bool processColButton(SLMIDIPacket *packet);
-bool processGridButton(SLMIDIPacket *packet);
-void clockInterruptCallback(void);
-void resetInterruptCallback(void);
-
-void endTriggerOutput(size_t outputIndex);
-void updateOutput(size_t outputIndex, uint8_t value);
-
-step_sequence_t * getCurrentSequenceSQ(void);
-step_sequence_t * getCurrentSequenceLS(void);
+void wrap_ls_midi_snd(void * ctx, SLMIDIPacket * pkt, uint8_t channel);
+void wrap_mc_clock_snd(void * ctx, SLMIDIPacket * pkt);
+void wrap_signal(void * ctx);
 
 // -----------------------------------------------------------------
 
-void wrap_sq_updateMutedTriggers(void *s, uint8_t triggerIndex) {
-	ls_updateRow(&ls, triggerIndex);
-	ls_updateFnButtons(&ls);
-	ls_updateOutColumn(&ls);
-}
-
-void wrap_sq_updatePattern(void *s, uint8_t sequenceIndex, uint8_t pI) {
-	if (ls.current_sequence_index == sequenceIndex) {
-		if (ls.sequence_view_mode == kLaunchpadSequenceViewMode_Paginated) {
-			ls_updateRow(&ls, pI);
-		} else {
-			ls_updateGrid(&ls);
-		}
-	}
-}
-
-void wrap_sq_updateStep(void * s, uint8_t sequenceIndex, uint8_t pI, uint8_t stepIndex) {
-	if (ls.sequence_view_mode == kLaunchpadSequenceViewMode_Paginated) {
-		if (ls.current_sequence_index == sequenceIndex) {
-			ls_updateCell(&ls, stepIndex % LS_MAX_STEPS_PER_ROW, pI);
-		}
-	} else if (ls.sequence_view_mode == kLaunchpadSequenceViewMode_Grid) {
-		if (ls.current_sequence_index == sequenceIndex && pI == ls.trigger_index) {
-			ls_updateCell(&ls, stepIndex % LS_MAX_STEPS_PER_ROW, stepIndex / LS_MAX_STEPS_PER_ROW);
-		}
-	}
-	
-}
-
-void wrap_sq_updateState(void * s) {
-	ls_updateDisplay(&ls);
-}
-
-void wrap_sq_updateTriggers(void * s) {
-	ls_updateOutColumn(&ls);
-}
-
-void wrap_sq_updateTrigger(void * s, uint8_t triggerIndex) {
-	updateOutput(triggerIndex, sequencer.triggers[triggerIndex]);
-}
-
-void wrap_sq_updateSequenceIndex(void * s, uint8_t sequenceIndex) {
-	if (ls.auto_follow_sequence) {
-		ls.current_sequence_index = sequenceIndex;
-	}
+void wrap_ls_midi_snd(void * ctx, SLMIDIPacket * pkt, uint8_t channel) {
+	const launchpad_device_t * device = (const launchpad_device_t *)ctx;
 	
-	if (ls.current_sequence_index == sequenceIndex) {
-		ls_updateDisplay(&ls);
-	}
-}
-
-void wrap_sq_updateNextSequenceIndex(void * s) {
-	ls_updateDisplay(&ls);
-}
-
-void wrap_ls_midi_snd(SLMIDIPacket * pkt, uint8_t channel) {
-	if (gOutPort != NULL && gDest != NULL && pkt != NULL) {
+	if (gOutPort != NULL && device != NULL && device->dest != NULL && pkt != NULL && pkt->length > 0) {
 		// Initialize a MIDIPacketList
 		MIDITimeStamp timestamp = 0; // 0 will mean play now.
-		uint8_t buffer[128]; // storage space for MIDI Packets (max 65536)
+		uint8_t buffer[sizeof(MIDIPacketList) + SL_MIDI_PACKET_MAX_LENGTH]; // a whole flush fits in 1 packet
 
 		//MIDIPacketList packetList;
 		MIDIPacketList *packetlist = (MIDIPacketList*)buffer;
 		MIDIPacket *packet = MIDIPacketListInit(packetlist);
 		
-		// Create a MIDIPacket within the packetList
-		packet = MIDIPacketListAdd(packetlist, sizeof(buffer), packet, timestamp, 3, pkt->data);
+		// Create a MIDIPacket within the packetList, holding every message queued during the tick
+		packet = MIDIPacketListAdd(packetlist, sizeof(buffer), packet, timestamp, pkt->length, pkt->data);
 
 		// Check if the packet was added successfully
 		if (packet != NULL) {
 			// Send the packet list using MIDISend
-			MIDISend(gOutPort, gDest, packetlist);
+			MIDISend(gOutPort, device->dest, packetlist);
 		} else {
 			// Handle the case where the packet could not be added
 			// (e.g., packet buffer is too small)
@@ -148,235 +68,76 @@ void wrap_ls_midi_snd(SLMIDIPacket * pkt, uint8_t channel) {
 	}
 }
 
-void wrap_ls_midi_rcv(SLMIDIPacket * packet) {
-	if (packet == NULL) {
-		return;
-	}
-	
-	if (packet->length >= 3) {
-		//--------
-		if (!processFunButton(packet) && !processColButton(packet)) {
-			processGridButton(packet);
-		}
-#if DEBUG
-		if (ls_btnIsDown(packet)) {
-			printf("-----------------\n");
-			printf("SHIFT: %d\n", ls.shift_btn_hold);
-			printf("PAGE IDX: %d\n", ls.page_index);
-			printf("RECV: len: %d \t%02X %02X %02X\n",
-				   packet->length,
-				   packet->data[0],
-				   packet->data[1],
-				   packet->data[2]);
+void wrap_mc_clock_snd(void * ctx, SLMIDIPacket * pkt) {
+	if (gOutPort != NULL && gClockDest != NULL && pkt != NULL) {
+		// future timestamp: CoreMIDI delivers it on time, whatever the sending thread's jitter
+		MIDITimeStamp timestamp = pkt->timestamp != 0 ? tempo_nsToHostTime(pkt->timestamp) : 0;
+		uint8_t buffer[64];
+		MIDIPacketList *packetlist = (MIDIPacketList*)buffer;
+		MIDIPacket *packet = MIDIPacketListInit(packetlist);
+		
+		packet = MIDIPacketListAdd(packetlist, sizeof(buffer), packet, timestamp, pkt->length, pkt->data);
+		if (packet != NULL) {
+			MIDISend(gOutPort, gClockDest, packetlist);
 		}
-#endif
 	}
 }
 
-// -----------------------------------------------------------------
-
-bool processFunButton(SLMIDIPacket *packet) {
-	bool result = true;
-	
-	if (ls_btnMapValue(packet) == LS_BT_SHIFT) {
-		ls.shift_btn_hold = ls_btnIsDown(packet);
-		ls_setExtButton(&ls, LS_BT_SHIFT, ls_btnIsDown(packet) ? LS_COLOR_YELLOW : LS_COLOR_NONE);
-	} else if (ls_btnMapValue(packet) == LS_BT_CLEAR) {
-		
-		ls.clear_btn_hold = ls_btnIsDown(packet);
-		ls_setExtButton(&ls, LS_BT_CLEAR, ls_btnIsDown(packet) ? LS_COLOR_RED : LS_COLOR_NONE);
+static void midi_read_callback(const MIDIPacketList *evtList, void *refCon, void *connRefCon)
+{
+	// connRefCon: the instance this source was connected to, whose renderer handles the buttons
+	if (gOutPort != NULL && connRefCon != NULL) {
+		MIDIPacket *packet = (MIDIPacket *)evtList->packet;
 		
-		if (ls.shift_btn_hold && ls.clear_btn_hold) {
-			seq_clearAllPatterns(getCurrentSequenceLS());
+		for (size_t j = 0; j < evtList->numPackets; ++j) {
+			SLMIDIPacket *pkt = (SLMIDIPacket *)packet;
+			wrap_ls_midi_rcv(connRefCon, pkt);
+			packet = MIDIPacketNext(packet);
 		}
-	} else if (ls_btnMapValue(packet) == LS_BT_UP_ARROW && ls_btnIsDown(packet)) {
-#if DEBUG
-		sequencer.current_direction = kDirection_Forward;
-		//clockInterruptCallback();
-#endif
-	} else if (ls_btnMapValue(packet) == LS_BT_DOWN_ARROW && ls_btnIsDown(packet)) {
-#if DEBUG
-		sequencer.current_direction = kDirection_Backward;
-		//clockInterruptCallback();
-#endif
-	} else if (ls_btnMapValue(packet) == LS_BT_LEFT_ARROW && ls_btnIsDown(packet)) {
-		ls_incrPageIndex(&ls, -1);
-	} else if (ls_btnMapValue(packet) == LS_BT_RIGHT_ARROW && ls_btnIsDown(packet)) {
-		ls_incrPageIndex(&ls, 1);
-	} else if (ls_btnMapValue(packet) == LS_BT_RESET && ls_btnIsDown(packet)) {
-#if DEBUG
-		sequencer_resetCurrentStepIndexes(&sequencer, ls.current_sequence_index);
-#endif
-	} else if (ls_btnMapValue(packet) == LS_BT_MODE && ls_btnIsDown(packet)) {
-		//TODO: method
-		ls.current_view_mode = (LaunchpadViewMode)utils_circularLoopGetIndex(ls.current_view_mode, 1, 3);
-		//ls.current_view_mode = !ls.current_view_mode;
-		ls_updateDisplay(&ls);
-	} else {
-		result = false;
 	}
-	
-	return result;
 }
 
-bool processColButton(SLMIDIPacket *packet) {
-	//uint16_t baseValue = LS_BT_VOL;
-	for (size_t i = 0; i < N_TRIGGERS; i++) {
-		/*
-		 BT VALUE Example:
-		 0x9008
-		 0x9018
-		 0x9028
-		 */
-		uint16_t v = 0x90 << 8 | i << 4 | 0x08;
-		if (ls_btnMapValue(packet) == v && ls_btnIsDown(packet)) {
-			if (ls.sequence_view_mode == kLaunchpadSequenceViewMode_Paginated) {
-				if (ls.clear_btn_hold) {
-					seq_clearPattern(getCurrentSequenceLS(), i);
-				}
-				
-				if (ls.current_view_mode == kLaunchpadViewMode_Mute) {
-					sequencer_setMutedPattern(&sequencer, i, !sequencer.muted_triggers[i]);
-				}
-			} else {
-				ls.trigger_index = i;
-				ls_updateDisplay(&ls);
-			}
-			
-			return true;
-		}
-	}
-	
-	return false;
+// Ctrl-C, kill: out of the run loop, so the shutdown below it still runs (on the main queue, not in a signal handler)
+void wrap_signal(void * ctx) {
+	CFRunLoopStop(CFRunLoopGetMain());
 }
 
-bool processGridButton(SLMIDIPacket *packet) {
-	SLMIDIMessageType   type = packet->data[0] & 0xF0;
-	uint8_t             incommingChannel = packet->data[0] & 0x0F;
+void watchSignal(int sig) {
+	dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_SIGNAL, sig, 0, dispatch_get_main_queue());
 	
-	if (ls_btnIsDown(packet)) {
-		if (type == kSLMIDIMessageType_NoteOn) {
-			uint8_t x = packet->data[1] % 16;
-			uint8_t y = (packet->data[1] - x) / 16;
-			
-			switch(ls.current_view_mode) {
-				case kLaunchpadViewMode_Pattern:
-				case kLaunchpadViewMode_Mute:
-					if (!ls.shift_btn_hold) {
-						//toggle one step
-						ls_toggleStep(&ls, x, y);
-					} else {
-						//determines the last step
-						ls_updateLastStepIndex(&ls, x, y);
-					}
-					break;
-				case kLaunchpadViewMode_Sequence:
-					if (x < 4 && y < 4) {
-						//sequence select section
-						uint8_t newSequenceIndex = x + 4 * y;
-						if (!ls.shift_btn_hold) {
-							ls_setCurrentSequenceIndex(&ls, newSequenceIndex);
-						} else {
-							sequencer_setNextSequenceIndex(ls.sequencer, newSequenceIndex);
-						}
-					}
-					break;
-				default:
-					break;
-			}
-			
-			return true;
-		}
-	}
-	
-	return false;
-}
-
-// ------
-
-step_sequence_t * getCurrentSequenceSQ(void) {
-	return sequencer_getCurrentSequence(&sequencer);
-}
-
-step_sequence_t * getCurrentSequenceLS(void) {
-	return ls_getCurrentSequence(&ls);
-}
-
-// --- Interrupts ---
-
-void clockInterruptCallback(void) {
-	/*
-	* When there is no clock in trigger no sequenced output will be triggered !
-	*/
-
-	sequencer_clock(&sequencer);
-}
-
-void resetInterruptCallback(void) {
-	//TODO: fix & check if play/stop necessary (normally no)
-	sequencer.clock_cpt = 0;
-	sequencer_stop(&sequencer);
-	sequencer_play(&sequencer);
-}
-
-void dirInterruptCallback(void) {
-	sequencer.current_direction = !sequencer.current_direction;
+	signal(sig, SIG_IGN);
+	dispatch_source_set_event_handler_f(source, wrap_signal);
+	dispatch_resume(source);
 }
 
-void updateOutput(size_t outputIndex, uint8_t value) {
-	if (outputIndex < N_TRIGGERS) {
-		//digitalWrite(t_outputs[outputIndex], value > 0 ? HIGH : LOW);
-	}
-}
-
-// --- MAIN ---
-
-void setup(void) {
-	// Setup interrupts
-	//attachInterrupt(digitalPinToInterrupt(CLOCK_IN_PIN), clockInterruptCallback, RISING);
-	//attachInterrupt(digitalPinToInterrupt(RESET_PIN), resetInterruptCallback, RISING);
-	//attachInterrupt(digitalPinToInterrupt(DIR_PIN), dirInterruptCallback, RISING);
-
-	// Setup MIDI
-	
-	// Setup structs
-	sequencer_init(&sequencer);
-	sequencer.step_updated_cb = wrap_sq_updateStep;
-	sequencer.pattern_updated_cb = wrap_sq_updatePattern;
-	sequencer.state_updated_cb = wrap_sq_updateState;
-	sequencer.triggers_updated_cb = wrap_sq_updateTriggers;
-	sequencer.trigger_updated_cb = wrap_sq_updateTrigger;
-	sequencer.muted_triggers_updated_cb = wrap_sq_updateMutedTriggers;
-	sequencer.next_seq_index_updated_cb = wrap_sq_updateNextSequenceIndex;
-	sequencer.sequence_index_updated_cb = wrap_sq_updateSequenceIndex;
-		
-	ls_init(&ls, &sequencer);
-	ls.midi_snd_cb = &wrap_ls_midi_snd;
-	ls.midi_rcv_cb = &wrap_ls_midi_rcv;
+bool isLaunchpad(MIDIEndpointRef endpoint) {
+	CFStringRef pname = NULL;
+	char name[64];
+	bool result = false;
 	
-	sequencer_play(&sequencer);
+	if (MIDIObjectGetStringProperty(endpoint, kMIDIPropertyName, &pname) == 0 && pname != NULL) {
+		if (CFStringGetCString(pname, name, sizeof(name), kCFStringEncodingUTF8)) {
+			result = strstr(name, LAUNCHPAD_NAME) != NULL;
+		}
+		CFRelease(pname);
+	}
 	
-	//ls_updateDisplay(&ls);
+	return result;
 }
 
-void loop() {
-		
-//	updateLeds(); // Update LEDs
-//	updateDisplay(); // Update Display
+app_instance_t * instanceForSource(MIDIEndpointRef src) {
+	MIDIEntityRef entity = NULL;
 	
-}
-
-static void midi_read_callback(const MIDIPacketList *evtList, void *refCon, void *connRefCon)
-{
-	if (gOutPort != NULL && gDest != NULL) {
-		MIDIPacket *packet = (MIDIPacket *)evtList->packet;
-		
-		for (size_t j = 0; j < evtList->numPackets; ++j) {
-			SLMIDIPacket *pkt = (SLMIDIPacket *)packet;
-			wrap_ls_midi_rcv(pkt);
-			packet = MIDIPacketNext(packet);
+	if (MIDIEndpointGetEntity(src, &entity) == 0 && entity != NULL) {
+		for (size_t i = 0; i < device_count; i++) {
+			if (devices[i].entity == entity) {
+				return devices[i].instance;
+			}
 		}
 	}
+	
+	// DAW clock, keyboards...: the first sequencer, the clock is shared anyway
+	return device_count > 0 ? devices[0].instance : NULL;
 }
 
 int main(int argc, const char * argv[]) {
@@ -388,57 +149,92 @@ int main(int argc, const char * argv[]) {
 	MIDIInputPortCreate(client, CFSTR("Input port"), midi_read_callback, NULL, &inPort);
 	MIDIOutputPortCreate(client, CFSTR("Output port"), &gOutPort);
 
-	// enumerate devices (not really related to purpose of the echo program
-	// but shows how to get information about devices)
 	int i, n;
-	CFStringRef pname, pmanuf, pmodel;
-	char name[64], manuf[64], model[64];
 
-	// open connections from all sources
+	// CoreMIDI honours timestamps
+	const app_host_t host = {
+		.clock_snd_cb = wrap_mc_clock_snd,
+		.clock_timestamps = true
+	};
+	app_init(&app, &host);
+	
+	// every Launchpad gets its own sequencer
+	n = (int)MIDIGetNumberOfDestinations();
+	for (i = 0; i < n && device_count < APP_MAX_INSTANCES; ++i) {
+		MIDIEndpointRef dest = MIDIGetDestination(i);
+		
+		if (isLaunchpad(dest)) {
+			devices[device_count].dest = dest;
+			MIDIEndpointGetEntity(dest, &devices[device_count].entity);
+			device_count++;
+		}
+	}
+	// none by name: destination 0, as before
+	if (device_count == 0 && n > 0) {
+		devices[0].dest = MIDIGetDestination(0);
+		devices[0].entity = NULL;
+		device_count = 1;
+	}
+	if (n > midi_clock_out_dest)
+		gClockDest = MIDIGetDestination(midi_clock_out_dest);
+	
+	for (size_t d = 0; d < device_count; d++) {
+		devices[d].instance = app_addInstance(&app, wrap_ls_midi_snd, &devices[d]);
+	}
+	printf("%zu Launchpad(s)\n", device_count);
+	
+	// applied by the clock before the first step
+	for (size_t d = 0; d < device_count && d + 1 < (size_t)argc; d++) {
+		const int mapped = preset_map(&banks[d], argv[d + 1]);
+		if (mapped > 0) {
+			// a bank only partly loaded is not written back over the full one
+			if (!app_loadBank(devices[d].instance, banks[d].bank)) {
+				fprintf(stderr, "%s: lanes of some patterns dropped, left as is\n", argv[d + 1]);
+				banks[d].writable = false;
+			}
+		} else if (mapped < 0) {
+			fprintf(stderr, "%s: not a bank this version reads, left as is\n", argv[d + 1]);
+		}
+	}
+
+	// open connections from all sources, each one to the sequencer of its device
 	n = (int)MIDIGetNumberOfSources();
 	printf("%d sources\n", n);
 	for (i = 0; i < n; ++i) {
 		MIDIEndpointRef src = MIDIGetSource(i);
-		MIDIPortConnectSource(inPort, src, NULL);
+		MIDIPortConnectSource(inPort, src, instanceForSource(src));
 	}
-
-	// find the first destination
-	n = (int)MIDIGetNumberOfDestinations();
-	if (n > 0)
-		gDest = MIDIGetDestination(0);
-
-	if (gDest != NULL) {
-//		MIDIObjectGetStringProperty(gDest, kMIDIPropertyName, &pname);
-//		CFStringGetCString(pname, name, sizeof(name), 0);
-//		CFRelease(pname);
-//		printf("Echoing to channel %d of %s\n", midi_out_channel, name);
-	} else {
-//		printf("No MIDI destinations present\n");
+	
+	// one renderer worker per Launchpad, triggers of all of them from one dispatcher
+	if (app_startWorkers(&app, (uint8_t)device_count) < 0) {
+		fprintf(stderr, "cannot start the engine threads\n");
+		return 1;
 	}
+	trace_start(&app.trace);
+	tempo_start(&app.internal_clock);
+	midiclock_masterRun(&app.clock_out);
 	
-	setup();
+	watchSignal(SIGINT);
+	watchSignal(SIGTERM);
+	CFRunLoopRun();
 	
-	// Create a dispatch queue (you can use the main queue or create a custom one)
-	dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
-	// Create a dispatch source timer
-	dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue);
+	// the clock is stopped, nothing else writes the sequencers
+	tempo_stop(&app.internal_clock);
+	midiclock_masterShutdown(&app.clock_out);
+	app_stopWorkers(&app);
+	trace_stop(&app.trace);
+	app_printLatencies(&app, stdout);
 	
-	if (timer) {
-		// Set the time interval for the timer (in nanoseconds)
-		uint64_t interval = NSEC_PER_SEC * 0.06 / 3; // 1 second
-		dispatch_source_set_timer(timer, dispatch_time(DISPATCH_TIME_NOW, 0), interval, 0);
+	for (size_t d = 0; d < device_count && d + 1 < (size_t)argc; d++) {
+		preset_bank_t bank;
 		
-		// Define the event handler block for the timer
-		dispatch_source_set_event_handler(timer, ^{
-			clockInterruptCallback();
-		});
-		
-		// Start the timer
-		dispatch_resume(timer);
+		// a file we could not read is someone else's: never overwritten
+		if (banks[d].writable) {
+			preset_save(&bank, &devices[d].instance->sequencer);
+			preset_writeFile(&bank, argv[d + 1]);
+		}
+		preset_unmap(&banks[d]);
 	}
 	
-
-	CFRunLoopRun();
-	
 	return 0;
 }
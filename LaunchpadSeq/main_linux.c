@@ -0,0 +1,375 @@
+//
+//  main_linux.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#if defined(__linux__)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include "app.h"
+#include "reactor.h"
+#include "transport.h"
+#include "offline.h"
+#include "preset.h"
+
+/*
+*       Linux host: the whole engine on one real-time thread around one epoll.
+*       Clock, trigger dispatcher, renderer and clock out are timerfds, the Launchpad
+*       and the clock port are rawmidi fds. No handler ever runs concurrently with another.
+*
+*       usage: LaunchpadSeq [-l <launchpad device>]... [-c <clock device>] [-p <bank file>]... [-w <swing %>]
+*       devices: hw:<card>,<device> or a path, one sequencer per -l (up to APP_MAX_INSTANCES),
+*       no -l: in-process loopback (no hardware)
+*       bank n: loaded by sequencer n when it exists, written back on exit
+*       swing: 50 (straight) to 75, every sequencer
+*
+*       offline: LaunchpadSeq -r <file.mid> [-b <bars>] [-s <sequence,sequence,...>] [-p <bank file>] [-w <swing %>]
+*                LaunchpadSeq -R <prefix> [-b <bars>] [-j <threads>] [-p <bank file>] [-w <swing %>]    (<prefix><sequence>.mid, in parallel)
+*/
+
+app_t						app;
+reactor_t					reactor;
+midi_transport_t			launchpad_ports[APP_MAX_INSTANCES];
+midi_transport_t			launchpad_loopback;								// device end when no Launchpad
+midi_transport_t			clock_port;
+preset_file_t				banks[APP_MAX_INSTANCES];							// mapped read only, as long as the clock may load them
+uint32_t					loopback_bytes = 0;
+
+void wrap_tp_ls_snd(void * ctx, SLMIDIPacket * pkt, uint8_t channel);
+void wrap_tp_clock_snd(void * ctx, SLMIDIPacket * pkt);
+void wrap_tp_rcv(void * ctx, SLMIDIPacket * pkt);
+void wrap_tp_loopback_rcv(void * ctx, SLMIDIPacket * pkt);
+void wrap_rt_read(void * ctx, int fd);
+void wrap_rt_write(void * ctx, int fd);
+uint64_t wrap_rt_tempo(void * ctx, uint64_t now_ns);
+uint64_t wrap_rt_scheduler(void * ctx, uint64_t now_ns);
+uint64_t wrap_rt_render(void * ctx, uint64_t now_ns);
+uint64_t wrap_rt_clock_out(void * ctx, uint64_t now_ns);
+
+// -----------------------------------------------------------------
+
+// never waits for the driver: what it did not take goes out when the fd is writable
+void sendNow(midi_transport_t * t, const uint8_t * data, size_t length) {
+	if (transport_send(t, data, length) == 0) {
+		reactor_watchWrite(&reactor, t->fd, wrap_rt_write);
+	}
+}
+
+void wrap_tp_ls_snd(void * ctx, SLMIDIPacket * pkt, uint8_t channel) {
+	if (pkt != NULL && pkt->length > 0) {
+		sendNow((midi_transport_t *)ctx, pkt->data, pkt->length);
+	}
+}
+
+void wrap_tp_clock_snd(void * ctx, SLMIDIPacket * pkt) {
+	// rawmidi has no timestamps: the master sends each byte when it is due
+	if (pkt != NULL && clock_port.fd >= 0) {
+		sendNow(&clock_port, pkt->data, pkt->length);
+	}
+}
+
+void wrap_tp_rcv(void * ctx, SLMIDIPacket * pkt) {
+	// clock port and Launchpad alike, sync bytes are filtered first
+	wrap_ls_midi_rcv(ctx, pkt);
+}
+
+void wrap_tp_loopback_rcv(void * ctx, SLMIDIPacket * pkt) {
+	loopback_bytes += pkt->length;
+}
+
+void wrap_rt_read(void * ctx, int fd) {
+	if (transport_read((midi_transport_t *)ctx) < 0) {
+		// unplugged
+		reactor_stop(&reactor);
+		return;
+	}
+	// the renderer handles the buttons: one frame now rather than on its next timer
+	app_render(&app, 0, 1);
+}
+
+void wrap_rt_write(void * ctx, int fd) {
+	// all sent or the fd gone: nothing left to wait for
+	if (transport_flush((midi_transport_t *)ctx) != 0) {
+		reactor_watchWrite(&reactor, fd, NULL);
+	}
+}
+
+uint64_t wrap_rt_tempo(void * ctx, uint64_t now_ns) {
+	return tempo_process(&app.internal_clock, now_ns);
+}
+
+uint64_t wrap_rt_scheduler(void * ctx, uint64_t now_ns) {
+	return app_dispatch(&app, now_ns);
+}
+
+uint64_t wrap_rt_render(void * ctx, uint64_t now_ns) {
+	app_render(&app, 0, 1);
+	return now_ns + RENDER_DEFAULT_PERIOD_NS;
+}
+
+uint64_t wrap_rt_clock_out(void * ctx, uint64_t now_ns) {
+	return midiclock_masterProcess(&app.clock_out, now_ns);
+}
+
+int renderOffline(const char * path, const char * prefix, uint16_t bars, const char * chain, uint8_t threads) {
+	const size_t jobCount = path != NULL ? 1 : N_SEQUENCES;
+	// 2 events of at most 8 bytes per hit, up to LANE_RATCHET_MAX hits per trigger and step
+	const size_t capacity = 64 + (size_t)bars * 16 * N_TRIGGERS * LANE_RATCHET_MAX * 2 * 8;
+	offline_job_t jobs[N_SEQUENCES];
+	uint8_t * buffer = malloc(capacity * jobCount);
+	uint64_t ticks = 0;
+	char name[256];
+	int result = 0;
+	
+	if (buffer == NULL) {
+		return 1;
+	}
+	
+	for (size_t i = 0; i < jobCount; i++) {
+		offline_initJob(&jobs[i], &app.instances[0].sequencer, buffer + i * capacity, capacity);
+		jobs[i].bars = bars;
+		
+		if (path != NULL) {
+			// "0,1,3"
+			for (const char * c = chain; c != NULL && *c != '\0' && jobs[i].chain_length < N_SEQUENCES; ) {
+				jobs[i].chain[jobs[i].chain_length++] = (uint8_t)strtoul(c, (char **)&c, 10) % N_SEQUENCES;
+				c = *c == ',' ? c + 1 : NULL;
+			}
+		} else {
+			jobs[i].chain[0] = i;
+			jobs[i].chain_length = 1;
+		}
+	}
+	
+	const uint64_t start = tempo_now();
+	if (offline_renderParallel(jobs, jobCount, threads) > 0) {
+		fprintf(stderr, "render buffer too small\n");
+		result = 1;
+	}
+	const uint64_t elapsed = tempo_now() - start;
+	
+	for (size_t i = 0; i < jobCount && result == 0; i++) {
+		if (path == NULL) {
+			snprintf(name, sizeof(name), "%s%zu.mid", prefix, i);
+		}
+		if (offline_writeFile(&jobs[i], path != NULL ? path : name) < 0) {
+			fprintf(stderr, "cannot write %s\n", path != NULL ? path : name);
+			result = 1;
+		}
+		ticks += jobs[i].ticks;
+		printf("%s: %llu ticks, %u events, checksum %08X\n",
+			   path != NULL ? path : name,
+			   (unsigned long long)jobs[i].ticks,
+			   jobs[i].events,
+			   jobs[i].checksum);
+	}
+	if (elapsed > 0) {
+		printf("%.0f ticks/s\n", (double)ticks * 1e9 / elapsed);
+	}
+	
+	free(buffer);
+	
+	return result;
+}
+
+void signalHandler(int sig) {
+	reactor_stop(&reactor);
+}
+
+void * reactorThread(void * arg) {
+	reactor_run((reactor_t *)arg);
+	return NULL;
+}
+
+// --- MAIN ---
+
+int main(int argc, const char * argv[]) {
+	const char * launchpadDevices[APP_MAX_INSTANCES];
+	uint8_t launchpadCount = 0;
+	const char * bankPaths[APP_MAX_INSTANCES];
+	uint8_t bankCount = 0;
+	const char * clockDevice = NULL;
+	const char * renderPath = NULL;
+	const char * renderPrefix = NULL;
+	const char * renderChain = NULL;
+	uint16_t renderBars = OFFLINE_DEFAULT_BARS;
+	uint8_t renderThreads = 0;
+	uint8_t swing = SEQUENCER_SWING_STRAIGHT;
+	pthread_t thread;
+	
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-l") == 0) {
+			if (launchpadCount < APP_MAX_INSTANCES) {
+				launchpadDevices[launchpadCount++] = argv[i + 1];
+			}
+		} else if (strcmp(argv[i], "-p") == 0) {
+			if (bankCount < APP_MAX_INSTANCES) {
+				bankPaths[bankCount++] = argv[i + 1];
+			}
+		} else if (strcmp(argv[i], "-c") == 0) {
+			clockDevice = argv[i + 1];
+		} else if (strcmp(argv[i], "-r") == 0) {
+			renderPath = argv[i + 1];
+		} else if (strcmp(argv[i], "-R") == 0) {
+			renderPrefix = argv[i + 1];
+		} else if (strcmp(argv[i], "-b") == 0) {
+			renderBars = (uint16_t)atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-s") == 0) {
+			renderChain = argv[i + 1];
+		} else if (strcmp(argv[i], "-j") == 0) {
+			renderThreads = (uint8_t)atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-w") == 0) {
+			swing = (uint8_t)atoi(argv[i + 1]);
+		}
+	}
+	
+	if (renderPath != NULL || renderPrefix != NULL) {
+		// no device, no clock: the sequences as the first instance starts with
+		const app_host_t host = { 0 };
+		app_init(&app, &host);
+		app_addInstance(&app, NULL, NULL);
+		if (bankCount > 0) {
+			if (preset_map(&banks[0], bankPaths[0]) <= 0) {
+				fprintf(stderr, "cannot load %s\n", bankPaths[0]);
+				return 1;
+			}
+			if (sequencer_load(&app.instances[0].sequencer, banks[0].bank) < 0) {
+				fprintf(stderr, "%s: lanes of some patterns dropped, more than %d patterns use them\n", bankPaths[0], LANE_POOL_SLOTS);
+			}
+		}
+		if (sequencer_setSwing(&app.instances[0].sequencer, swing) < 0) {
+			fprintf(stderr, "swing: %d-%d\n", SEQUENCER_SWING_STRAIGHT, SEQUENCER_SWING_MAX);
+			return 1;
+		}
+		return renderOffline(renderPath, renderPrefix, renderBars, renderChain, renderThreads);
+	}
+	
+	for (size_t i = 0; i < APP_MAX_INSTANCES; i++) {
+		transport_init(&launchpad_ports[i]);
+	}
+	transport_init(&launchpad_loopback);
+	transport_init(&clock_port);
+	
+	for (size_t i = 0; i < launchpadCount; i++) {
+		if (transport_openRawMidi(&launchpad_ports[i], launchpadDevices[i]) < 0) {
+			fprintf(stderr, "cannot open %s\n", launchpadDevices[i]);
+			return 1;
+		}
+	}
+	if (launchpadCount == 0) {
+		if (transport_openLoopback(&launchpad_ports[0], &launchpad_loopback) < 0) {
+			return 1;
+		}
+		launchpadCount = 1;
+	}
+	if (clockDevice != NULL && transport_openRawMidi(&clock_port, clockDevice) < 0) {
+		fprintf(stderr, "cannot open %s\n", clockDevice);
+		return 1;
+	}
+	launchpad_loopback.receive_cb = wrap_tp_loopback_rcv;
+	
+	const app_host_t host = {
+		.clock_snd_cb = wrap_tp_clock_snd,
+		.clock_timestamps = false
+	};
+	app_init(&app, &host);
+	
+	// one sequencer per Launchpad, each port delivers to its own
+	for (size_t i = 0; i < launchpadCount; i++) {
+		launchpad_ports[i].receive_cb = wrap_tp_rcv;
+		launchpad_ports[i].ctx = app_addInstance(&app, wrap_tp_ls_snd, &launchpad_ports[i]);
+	}
+	// the clock is not running yet: set directly
+	for (size_t i = 0; i < app.instance_count; i++) {
+		if (sequencer_setSwing(&app.instances[i].sequencer, swing) < 0) {
+			fprintf(stderr, "swing: %d-%d\n", SEQUENCER_SWING_STRAIGHT, SEQUENCER_SWING_MAX);
+			return 1;
+		}
+	}
+	// applied by the clock before the first step
+	for (size_t i = 0; i < bankCount && i < app.instance_count; i++) {
+		const int mapped = preset_map(&banks[i], bankPaths[i]);
+		if (mapped > 0) {
+			// a bank only partly loaded is not written back over the full one
+			if (!app_loadBank(&app.instances[i], banks[i].bank)) {
+				fprintf(stderr, "%s: lanes of some patterns dropped, left as is\n", bankPaths[i]);
+				banks[i].writable = false;
+			}
+		} else if (mapped == 0) {
+			fprintf(stderr, "%s: no bank yet, created on exit\n", bankPaths[i]);
+		} else {
+			fprintf(stderr, "%s: not a bank this version reads, left as is\n", bankPaths[i]);
+		}
+	}
+	// the external clock is shared, any instance hands it over
+	clock_port.receive_cb = wrap_tp_rcv;
+	clock_port.ctx = &app.instances[0];
+	
+	if (reactor_init(&reactor) < 0) {
+		return 1;
+	}
+	
+	const uint64_t now = tempo_now();
+	tempo_reset(&app.internal_clock, now);
+	reactor_addTimer(&reactor, tempo_nextDeadline(&app.internal_clock), wrap_rt_tempo, NULL);
+	reactor_addTimer(&reactor, now, wrap_rt_scheduler, NULL);
+	reactor_addTimer(&reactor, now, wrap_rt_render, NULL);
+	reactor_addTimer(&reactor, now, wrap_rt_clock_out, NULL);
+	for (size_t i = 0; i < launchpadCount; i++) {
+		reactor_addFd(&reactor, launchpad_ports[i].fd, wrap_rt_read, &launchpad_ports[i]);
+	}
+	reactor_addFd(&reactor, launchpad_loopback.fd, wrap_rt_read, &launchpad_loopback);
+	reactor_addFd(&reactor, clock_port.fd, wrap_rt_read, &clock_port);
+	
+	// the only thread doing stdio
+	trace_start(&app.trace);
+	
+	signal(SIGINT, signalHandler);
+	signal(SIGTERM, signalHandler);
+	
+	// real-time when allowed, the clock's priority since it runs the clock
+	if (tempo_createThread(&thread, reactorThread, &reactor, TEMPO_THREAD_PRIORITY) < 0) {
+		return 1;
+	}
+	pthread_join(thread, NULL);
+	trace_stop(&app.trace);
+	app_printLatencies(&app, stdout);
+	
+	printf("timer late max: %lld us, missed ticks: %llu, loopback bytes: %u\n",
+		   (long long)(reactor.timer_late_max_ns / 1000),
+		   (unsigned long long)app.internal_clock.stats.missed_ticks,
+		   loopback_bytes);
+	
+	// the clock is stopped, nothing else writes the sequencers
+	for (size_t i = 0; i < bankCount && i < app.instance_count; i++) {
+		preset_bank_t bank;
+		
+		// a file we could not read is someone else's: never overwritten
+		if (banks[i].writable) {
+			preset_save(&bank, &app.instances[i].sequencer);
+			if (preset_writeFile(&bank, bankPaths[i]) < 0) {
+				fprintf(stderr, "cannot write %s\n", bankPaths[i]);
+			}
+		}
+		preset_unmap(&banks[i]);
+	}
+	
+	reactor_close(&reactor);
+	for (size_t i = 0; i < APP_MAX_INSTANCES; i++) {
+		transport_close(&launchpad_ports[i]);
+	}
+	transport_close(&launchpad_loopback);
+	transport_close(&clock_port);
+	
+	return 0;
+}
+
+#endif
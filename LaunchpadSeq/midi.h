@@ -8,10 +8,13 @@
 #ifndef midi_h
 #define midi_h
 
+#define SL_MIDI_CLOCK_PPQN				24
+#define SL_MIDI_PACKET_MAX_LENGTH		512							// fits a full RGB SysEx frame
+
 typedef struct SLMIDIPacket {
 	uint64_t				timestamp;
 	uint16_t				length;
-	uint8_t					data[32];
+	uint8_t					data[SL_MIDI_PACKET_MAX_LENGTH];
 } SLMIDIPacket;
 
 typedef enum SLMIDIMessageType {
@@ -23,10 +26,12 @@ typedef enum SLMIDIMessageType {
 	kSLMIDIMessageType_AftertouchChannel		    	= 0xD0,
 	kSLMIDIMessageType_PitchWheel					    = 0xE0,
 	kSLMIDIMessageType_System						    = 0xF0,
-	kSLMIDIMessageType_SystemClockTick				    = 0xFA,
-	kSLMIDIMessageType_SystemClockStart				    = 0xFB,
-	kSLMIDIMessageType_SystemClockContinue		    	= 0xFC,
-	kSLMIDIMessageType_SystemClockStop				    = 0xFD,
+	kSLMIDIMessageType_SystemSongPosition				= 0xF2,
+	kSLMIDIMessageType_SystemExclusiveEnd				= 0xF7,
+	kSLMIDIMessageType_SystemClockTick				    = 0xF8,
+	kSLMIDIMessageType_SystemClockStart				    = 0xFA,
+	kSLMIDIMessageType_SystemClockContinue		    	= 0xFB,
+	kSLMIDIMessageType_SystemClockStop				    = 0xFC,
 	kSLMIDIMessageType_SystemClockActiveSensing			= 0xFE,
 	kSLMIDIMessageType_SystemClockReset			    	= 0xFF
 } SLMIDIMessageType;
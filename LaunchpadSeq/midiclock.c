@@ -0,0 +1,311 @@
+//
+//  midiclock.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#include "midiclock.h"
+#include <string.h>
+
+#include "noalloc.h"
+
+// MIDI ticks per tempo tick
+uint8_t _midiclock_ratio(tempo_clock_t * tempo) {
+	const uint16_t ppqn = tempo->ppqn;
+	return ppqn > 0 && ppqn <= SL_MIDI_CLOCK_PPQN ? SL_MIDI_CLOCK_PPQN / ppqn : 1;
+}
+
+double _midiclock_clampPeriod(double period) {
+	const double minPeriod = (double)NSEC_PER_MINUTE / (MIDICLOCK_MAX_BPM * SL_MIDI_CLOCK_PPQN);
+	const double maxPeriod = (double)NSEC_PER_MINUTE / (MIDICLOCK_MIN_BPM * SL_MIDI_CLOCK_PPQN);
+	
+	if (period < minPeriod) {
+		return minPeriod;
+	}
+	if (period > maxPeriod) {
+		return maxPeriod;
+	}
+	return period;
+}
+
+// 2nd order PLL: phase follows the ticks, period follows the phase error
+void _midiclock_updatePll(midi_clock_t * mc, uint64_t now_ns) {
+	if (!mc->has_estimate) {
+		mc->phase_ns = now_ns;
+		if (mc->last_raw_ns != 0 && now_ns > mc->last_raw_ns) {
+			mc->period_ns = _midiclock_clampPeriod(now_ns - mc->last_raw_ns);
+			mc->has_estimate = true;
+		}
+	} else {
+		const double predicted = mc->phase_ns + mc->period_ns;
+		mc->error_ns = (double)now_ns - predicted;
+		
+		if (mc->error_ns > mc->period_ns || mc->error_ns < -mc->period_ns) {
+			// tempo jump or dropout: relock from scratch
+			mc->phase_ns = now_ns;
+			mc->period_ns = _midiclock_clampPeriod(now_ns - mc->last_raw_ns);
+		} else {
+			mc->phase_ns = predicted + MIDICLOCK_PLL_ALPHA * mc->error_ns;
+			mc->period_ns = _midiclock_clampPeriod(mc->period_ns + MIDICLOCK_PLL_BETA * mc->error_ns);
+		}
+	}
+	
+	mc->last_raw_ns = now_ns;
+}
+
+void _midiclock_tick(midi_clock_t * mc, uint64_t now_ns) {
+	const uint8_t ratio = _midiclock_ratio(mc->tempo);
+	
+	_midiclock_updatePll(mc, now_ns);
+	
+	if (mc->ticks % ratio == 0) {
+		if (mc->tempo->holding) {
+			// first tick after Start/Continue is due now
+			// without an estimate yet, use the slowest tempo: the next MIDI ticks will correct it before it fires
+			const double period = mc->has_estimate ? mc->period_ns : _midiclock_clampPeriod(1e18);
+			tempo_follow(mc->tempo, now_ns, period * ratio);
+			tempo_hold(mc->tempo, false);
+		} else if (mc->has_estimate) {
+			// move the schedule onto the smoothed timeline (this tick may have fired already)
+			tempo_follow(mc->tempo, (uint64_t)mc->phase_ns, mc->period_ns * ratio);
+		}
+	}
+	
+	mc->ticks++;
+}
+
+//-----------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------
+
+void midiclock_init(midi_clock_t * mc, tempo_clock_t * tempo) {
+	mc->tempo = tempo;
+	mc->ticks = 0;
+	mc->running = false;
+	mc->has_estimate = false;
+	mc->last_raw_ns = 0;
+	mc->phase_ns = 0.0;
+	mc->period_ns = 0.0;
+	mc->error_ns = 0.0;
+	mc->spp_state = 0;
+	mc->spp = 0;
+}
+
+void midiclock_receive(midi_clock_t * mc, uint8_t byte, uint64_t now_ns) {
+	// Song position pointer: F2 <lsb> <msb>
+	if (mc->spp_state > 0 && byte < 0x80) {
+		if (mc->spp_state == 2) {
+			mc->spp = byte;
+		} else {
+			mc->spp |= (uint16_t)byte << 7;
+			mc->ticks = mc->spp * MIDICLOCK_TICKS_PER_SPP;
+			if (mc->position_cb != NULL) {
+				mc->position_cb(mc->ctx, mc->spp);
+			}
+		}
+		mc->spp_state--;
+		return;
+	}
+	
+	switch (byte) {
+		case kSLMIDIMessageType_SystemClockTick:
+			_midiclock_tick(mc, now_ns);
+			break;
+		case kSLMIDIMessageType_SystemClockStart:
+			mc->ticks = 0;
+			mc->running = true;
+			tempo_hold(mc->tempo, true);
+			if (mc->start_cb != NULL) {
+				mc->start_cb(mc->ctx);
+			}
+			break;
+		case kSLMIDIMessageType_SystemClockContinue:
+			mc->running = true;
+			tempo_hold(mc->tempo, true);
+			if (mc->continue_cb != NULL) {
+				mc->continue_cb(mc->ctx);
+			}
+			break;
+		case kSLMIDIMessageType_SystemClockStop:
+			mc->running = false;
+			tempo_hold(mc->tempo, true);
+			if (mc->stop_cb != NULL) {
+				mc->stop_cb(mc->ctx);
+			}
+			break;
+		case kSLMIDIMessageType_SystemSongPosition:
+			mc->spp_state = 2;
+			break;
+		default:
+			// a status byte cancels a pending song position
+			if (byte >= 0x80 && byte < kSLMIDIMessageType_SystemClockTick) {
+				mc->spp_state = 0;
+			}
+			break;
+	}
+}
+
+bool midiclock_process(midi_clock_t * mc, SLMIDIPacket * pkt, uint64_t now_ns) {
+	bool onlySync = pkt->length > 0;
+	
+	if (mc->tempo == NULL) {
+		return false;
+	}
+	
+	for (size_t i = 0; i < pkt->length; i++) {
+		const uint8_t byte = pkt->data[i];
+		
+		if (byte >= kSLMIDIMessageType_SystemClockTick || byte == kSLMIDIMessageType_SystemSongPosition || (mc->spp_state > 0 && byte < 0x80)) {
+			midiclock_receive(mc, byte, now_ns);
+		} else {
+			onlySync = false;
+		}
+	}
+	
+	return onlySync;
+}
+
+double midiclock_getBpm(midi_clock_t * mc) {
+	if (!mc->has_estimate) {
+		return 0.0;
+	}
+	
+	return (double)NSEC_PER_MINUTE / (mc->period_ns * SL_MIDI_CLOCK_PPQN);
+}
+
+// --- MASTER ---
+
+void _midiclock_masterSend(midi_clock_master_t * m, uint8_t byte, uint64_t time_ns) {
+	SLMIDIPacket pkt;
+	pkt.timestamp = m->timestamps ? time_ns : 0;
+	pkt.length = 1;
+	pkt.data[0] = byte;
+	
+	if (m->send_cb != NULL) {
+		m->send_cb(m->ctx, &pkt);
+	}
+}
+
+// MIDI ticks follow the tempo timeline: re-anchored when the tempo changes, never accumulated
+void _midiclock_masterUpdatePeriod(midi_clock_master_t * m) {
+	const double period = m->tempo->period_ns / _midiclock_ratio(m->tempo);
+	
+	if (period != m->period_ns) {
+		m->anchor_ns = m->next_tick_ns;
+		m->tick_index = 0;
+		m->period_ns = period;
+	}
+}
+
+void midiclock_masterInit(midi_clock_master_t * m, tempo_clock_t * tempo, bool timestamps) {
+	m->tempo = tempo;
+	m->lookahead_ns = timestamps ? MIDICLOCK_DEFAULT_LOOKAHEAD_NS : 0;
+	m->timestamps = timestamps;
+	m->running = false;
+	m->playing = false;
+	m->start_pending = false;
+	m->stop_pending = false;
+	m->start_due = false;
+	m->next_tick_ns = 0;
+	m->anchor_ns = 0;
+	m->tick_index = 0;
+	m->period_ns = 0.0;
+	m->sent_ticks = 0;
+}
+
+void midiclock_masterStart(midi_clock_master_t * m) {
+	m->start_pending = true;
+}
+
+void midiclock_masterStop(midi_clock_master_t * m) {
+	m->stop_pending = true;
+}
+
+uint64_t midiclock_masterProcess(midi_clock_master_t * m, uint64_t now_ns) {
+	const uint64_t horizon = now_ns + m->lookahead_ns;
+	
+	if (m->start_pending) {
+		// first tick on the next step tick of the internal clock
+		m->start_pending = false;
+		m->stop_pending = false;
+		m->next_tick_ns = tempo_nextDeadline(m->tempo);
+		m->anchor_ns = m->next_tick_ns;
+		m->tick_index = 0;
+		m->period_ns = 0.0;
+		m->start_due = true;
+		m->playing = true;
+	}
+	
+	if (m->stop_pending) {
+		m->stop_pending = false;
+		m->playing = false;
+		// after the ticks already handed to the driver
+		_midiclock_masterSend(m, kSLMIDIMessageType_SystemClockStop, m->next_tick_ns > now_ns ? m->next_tick_ns : now_ns);
+	}
+	
+	if (!m->playing) {
+		return now_ns + TEMPO_HOLD_POLL_NS;
+	}
+	
+	_midiclock_masterUpdatePeriod(m);
+	
+	while (m->next_tick_ns <= horizon) {
+		if (m->start_due) {
+			// right before the first tick, in both modes
+			_midiclock_masterSend(m, kSLMIDIMessageType_SystemClockStart, m->next_tick_ns);
+			m->start_due = false;
+		}
+		_midiclock_masterSend(m, kSLMIDIMessageType_SystemClockTick, m->next_tick_ns);
+		m->sent_ticks++;
+		m->tick_index++;
+		m->next_tick_ns = m->anchor_ns + (uint64_t)(m->tick_index * m->period_ns);
+	}
+	
+	return m->next_tick_ns - m->lookahead_ns;
+}
+
+#if defined(__APPLE__) || defined(__linux__)
+
+void * _midiclock_masterThread(void * arg) {
+	midi_clock_master_t * m = (midi_clock_master_t *)arg;
+	
+	while (m->running) {
+		const uint64_t wakeup = midiclock_masterProcess(m, tempo_now());
+		
+		if (m->timestamps || !m->playing) {
+			tempo_sleepUntil(wakeup);
+		} else {
+			// tight loop: sleep most of the way, spin the end
+			if (wakeup > MIDICLOCK_SPIN_NS) {
+				tempo_sleepUntil(wakeup - MIDICLOCK_SPIN_NS);
+			}
+			while (tempo_now() < wakeup) {
+			}
+		}
+	}
+	
+	return NULL;
+}
+
+int midiclock_masterRun(midi_clock_master_t * m) {
+	if (m->running) {
+		return 0;
+	}
+	
+	m->running = true;
+	if (pthread_create(&m->thread, NULL, _midiclock_masterThread, m) != 0) {
+		m->running = false;
+		return -1;
+	}
+	
+	return 1;
+}
+
+void midiclock_masterShutdown(midi_clock_master_t * m) {
+	if (m->running) {
+		m->running = false;
+		pthread_join(m->thread, NULL);
+	}
+}
+
+#endif
@@ -0,0 +1,89 @@
+//
+//  midiclock.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#ifndef midiclock_h
+#define midiclock_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "midi.h"
+#include "tempo.h"
+
+#define MIDICLOCK_PLL_ALPHA			0.2												// phase gain
+#define MIDICLOCK_PLL_BETA			0.01											// period gain (~alpha^2 / 4: critically damped)
+#define MIDICLOCK_MIN_BPM			20.0
+#define MIDICLOCK_MAX_BPM			300.0
+#define MIDICLOCK_TICKS_PER_SPP		6												// song position unit is a 16th note
+#define MIDICLOCK_DEFAULT_LOOKAHEAD_NS	10000000ULL									// 10 ms
+#define MIDICLOCK_SPIN_NS			200000ULL										// busy wait before each tick without timestamps
+
+/*
+*       Slaves a tempo_clock_t to an incoming 24 PPQN MIDI clock.
+*       Raw tick arrivals only feed the PLL: the tempo clock fires on the smoothed timeline.
+*/
+
+typedef struct midi_clock_t {
+	tempo_clock_t *				tempo;
+	uint32_t					ticks;											// MIDI ticks since start / song position
+	bool						running;										// between Start/Continue and Stop
+	bool						has_estimate;
+	uint64_t					last_raw_ns;
+	double						phase_ns;										// smoothed time of the last tick
+	double						period_ns;										// smoothed tick period
+	double						error_ns;										// last phase error (raw - predicted)
+	uint8_t						spp_state;										// song position bytes left to read
+	uint16_t					spp;
+	
+	void						(*start_cb)(void * ctx);
+	void						(*continue_cb)(void * ctx);
+	void						(*stop_cb)(void * ctx);
+	void						(*position_cb)(void * ctx, uint16_t sixteenths);
+	void *						ctx;
+} midi_clock_t;
+
+/*
+*       Sends 24 PPQN clock following a tempo_clock_t timeline.
+*       With timestamps, messages leave lookahead_ns early and the driver delivers them on time.
+*       Without, the sender thread sleeps until just before each tick and spins the rest.
+*/
+
+typedef struct midi_clock_master_t {
+	tempo_clock_t *				tempo;
+	uint64_t					lookahead_ns;
+	bool						timestamps;										// the transport honours SLMIDIPacket.timestamp
+	volatile bool				running;										// sender thread alive
+	volatile bool				playing;										// between Start and Stop
+	volatile bool				start_pending;
+	volatile bool				stop_pending;
+	bool						start_due;										// Start goes out with the first tick
+	uint64_t					next_tick_ns;
+	uint64_t					anchor_ns;
+	uint64_t					tick_index;										// from anchor_ns
+	double						period_ns;										// MIDI tick period
+	uint64_t					sent_ticks;
+#if defined(__APPLE__) || defined(__linux__)
+	pthread_t					thread;
+#endif
+	
+	void						(*send_cb)(void * ctx, SLMIDIPacket * pkt);		// pkt->timestamp: tempo_now() time, 0 = now
+	void *						ctx;
+} midi_clock_master_t;
+
+void 				midiclock_init(midi_clock_t * mc, tempo_clock_t * tempo);
+void 				midiclock_receive(midi_clock_t * mc, uint8_t byte, uint64_t now_ns);
+bool 				midiclock_process(midi_clock_t * mc, SLMIDIPacket * pkt, uint64_t now_ns);	//true if pkt only held sync messages
+double 				midiclock_getBpm(midi_clock_t * mc);
+
+void 				midiclock_masterInit(midi_clock_master_t * m, tempo_clock_t * tempo, bool timestamps);
+uint64_t 			midiclock_masterProcess(midi_clock_master_t * m, uint64_t now_ns);		//sends what is due, returns next wakeup
+void 				midiclock_masterStart(midi_clock_master_t * m);							//Start on the next step tick
+void 				midiclock_masterStop(midi_clock_master_t * m);
+int 				midiclock_masterRun(midi_clock_master_t * m);							//host sender thread
+void 				midiclock_masterShutdown(midi_clock_master_t * m);
+
+#endif /* midiclock_h */
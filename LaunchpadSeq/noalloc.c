@@ -0,0 +1,58 @@
+//
+//  noalloc.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#include <stdbool.h>
+
+_Thread_local bool			in_rt_path = false;								// set by the real-time paths themselves, see noalloc.h
+
+#if defined(__linux__) && defined(LS_DEBUG_ALLOC)
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+*       Debug only: the executable's malloc family shadows glibc's and forwards to it.
+*       in_rt_path is set around each clock tick and idle poll (app.c), render frame
+*       (render_process) and LED flush (ls_flush): an allocation from there aborts, with the
+*       stack still showing who made it
+*/
+
+void * 	__libc_malloc(size_t size);
+void * 	__libc_calloc(size_t count, size_t size);
+void * 	__libc_realloc(void * ptr, size_t size);
+void 	__libc_free(void * ptr);
+
+void _noalloc_check(const char * msg, size_t length) {
+	// no stdio: it may allocate itself
+	if (in_rt_path) {
+		write(STDERR_FILENO, msg, length);
+		abort();
+	}
+}
+
+void * malloc(size_t size) {
+	_noalloc_check("malloc on a real-time path\n", 27);
+	return __libc_malloc(size);
+}
+
+void * calloc(size_t count, size_t size) {
+	_noalloc_check("calloc on a real-time path\n", 27);
+	return __libc_calloc(count, size);
+}
+
+void * realloc(void * ptr, size_t size) {
+	_noalloc_check("realloc on a real-time path\n", 28);
+	return __libc_realloc(ptr, size);
+}
+
+void free(void * ptr) {
+	_noalloc_check("free on a real-time path\n", 25);
+	__libc_free(ptr);
+}
+
+#endif
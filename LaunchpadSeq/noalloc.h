@@ -0,0 +1,27 @@
+//
+//  noalloc.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#ifndef noalloc_h
+#define noalloc_h
+
+/*
+*       Engine files include this after every other header: the clock, MIDI input, render and
+*       reactor paths only ever use fixed size storage, so any allocator call in them is a
+*       compile error. Hosts (main.c, main_linux.c, bench.c) allocate at startup and do not.
+*
+*       A debug Linux build (-DLS_DEBUG_ALLOC, noalloc.c) also catches what the compiler
+*       cannot see, a library call allocating behind our back: malloc and free abort while
+*       the calling thread is on a real-time path (in_rt_path)
+*/
+
+#include <stdbool.h>
+
+extern _Thread_local bool	in_rt_path;										// clock tick or idle poll, render frame, LED flush
+
+#pragma GCC poison malloc calloc realloc free
+
+#endif /* noalloc_h */
@@ -0,0 +1,305 @@
+//
+//  offline.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#include "offline.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "tempo.h"
+#include "midi.h"
+
+#if defined(__APPLE__) || defined(__linux__)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "noalloc.h"
+
+#define OFFLINE_CLOCKS_PER_BAR		(4 * SEQUENCER_CLOCK_PPQN)
+
+typedef struct offline_state_t {
+	step_sequencer_t			sequencer;
+	offline_job_t *				job;
+	uint64_t					tick;
+	uint64_t					last_event_tick;
+	size_t						length;
+	bool						overflow;
+	bool						swapped;
+} offline_state_t;
+
+#if defined(__APPLE__) || defined(__linux__)
+typedef struct offline_pool_t {
+	offline_job_t *				jobs;
+	size_t						count;
+	atomic_size_t				next;
+	atomic_size_t				failed;
+} offline_pool_t;
+#endif
+
+void _offline_putByte(offline_state_t * st, uint8_t byte) {
+	if (st->length < st->job->capacity) {
+		st->job->buffer[st->length++] = byte;
+	} else {
+		st->overflow = true;
+	}
+}
+
+void _offline_putWord(offline_state_t * st, uint32_t value, uint8_t bytes) {
+	// big endian
+	while (bytes-- > 0) {
+		_offline_putByte(st, (uint8_t)(value >> (8 * bytes)));
+	}
+}
+
+void _offline_putVarLen(offline_state_t * st, uint32_t value) {
+	uint8_t groups[5];
+	uint8_t count = 0;
+	
+	do {
+		groups[count++] = value & 0x7F;
+		value >>= 7;
+	} while (value != 0);
+	
+	while (count-- > 0) {
+		_offline_putByte(st, groups[count] | (count > 0 ? 0x80 : 0x00));
+	}
+}
+
+void _offline_putEvent(offline_state_t * st, uint8_t status, uint8_t data1, uint8_t data2) {
+	_offline_putVarLen(st, (uint32_t)(st->tick - st->last_event_tick));
+	_offline_putByte(st, status);
+	_offline_putByte(st, data1);
+	_offline_putByte(st, data2);
+	st->last_event_tick = st->tick;
+	st->job->events++;
+}
+
+void _offline_putNote(offline_state_t * st, uint8_t triggerIndex, uint8_t value) {
+	const offline_job_t * job = st->job;
+	
+	if (value > 0) {
+		// STEP_ON: no velocity lane
+		_offline_putEvent(st, kSLMIDIMessageType_NoteOn | job->channel, job->notes[triggerIndex], value == STEP_ON ? OFFLINE_VELOCITY : value & 0x7F);
+	} else {
+		_offline_putEvent(st, kSLMIDIMessageType_NoteOff | job->channel, job->notes[triggerIndex], 0);
+	}
+}
+
+uint32_t _offline_checksum(const uint8_t * data, size_t length) {
+	uint32_t hash = 2166136261u;
+	
+	for (size_t i = 0; i < length; i++) {
+		hash = (hash ^ data[i]) * 16777619u;
+	}
+	
+	return hash;
+}
+
+void wrap_of_trigger(void * ctx, uint8_t triggerIndex) {
+	offline_state_t * st = (offline_state_t *)ctx;
+	
+	// on the sequencer's timeline, swing and offsets included
+	st->tick = st->sequencer.event_tick;
+	_offline_putNote(st, triggerIndex, st->sequencer.triggers[triggerIndex]);
+}
+
+void wrap_of_sequenceIndex(void * ctx, uint8_t sequenceIndex) {
+	((offline_state_t *)ctx)->swapped = true;
+}
+
+#if defined(__APPLE__) || defined(__linux__)
+void * _offline_worker(void * arg) {
+	offline_pool_t * pool = (offline_pool_t *)arg;
+	size_t index;
+	
+	while ((index = atomic_fetch_add(&pool->next, 1)) < pool->count) {
+		if (offline_render(&pool->jobs[index]) < 0) {
+			atomic_fetch_add(&pool->failed, 1);
+		}
+	}
+	
+	return NULL;
+}
+#endif
+
+//-----------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------
+
+void offline_initJob(offline_job_t * job, const step_sequencer_t * source, uint8_t * buffer, size_t capacity) {
+	memset(job, 0x00, sizeof(*job));
+	job->source = source;
+	job->bars = OFFLINE_DEFAULT_BARS;
+	job->bpm = DEFAULT_BPM;
+	job->channel = OFFLINE_DEFAULT_CHANNEL;
+	job->buffer = buffer;
+	job->capacity = capacity;
+	
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		job->notes[i] = OFFLINE_DEFAULT_NOTE + i;
+	}
+}
+
+int offline_render(offline_job_t * job) {
+	offline_state_t st;
+	step_sequencer_t * s = &st.sequencer;
+	const uint64_t start = tempo_now();
+	const uint64_t clocks = (uint64_t)job->bars * OFFLINE_CLOCKS_PER_BAR;
+	uint8_t position = 0;
+	size_t trackLength;
+	
+	memset(&st, 0x00, sizeof(st));
+	st.job = job;
+	job->length = 0;
+	job->events = 0;
+	
+	// same musical state, fresh transport, no observer but ours
+	memcpy(s, job->source, sizeof(*s));
+	s->tick = 0;
+	s->current_state = kSequencerState_Stopped;
+	s->next_sequence_index = NO_NEXT_SEQUENCE;
+	s->trace = NULL;
+	memset((void *) s->triggers, 0x00, sizeof(s->triggers));
+	s->step_updated_cb = NULL;
+	s->playhead_updated_cb = NULL;
+	s->pattern_updated_cb = NULL;
+	s->muted_triggers_updated_cb = NULL;
+	s->direction_updated_cb = NULL;
+	s->state_updated_cb = NULL;
+	s->sequence_index_updated_cb = wrap_of_sequenceIndex;
+	s->trigger_updated_cb = wrap_of_trigger;
+	s->triggers_updated_cb = NULL;
+	s->next_seq_index_updated_cb = NULL;
+	s->ctx = &st;
+	
+	if (job->chain_length > 0) {
+		sequencer_setSequenceIndex(s, job->chain[0]);
+	}
+	for (size_t i = 0; i < N_SEQUENCES; i++) {
+		sequencer_resetCurrentStepIndexes(s, i);
+	}
+	// first step on tick 0
+	sequencer_locate(s, 0);
+	if (job->chain_length > 1) {
+		sequencer_setNextSequenceIndex(s, job->chain[1]);
+	}
+	st.swapped = false;
+	
+	// header, format 0, one track
+	_offline_putWord(&st, 0x4D546864, 4);									// MThd
+	_offline_putWord(&st, 6, 4);
+	_offline_putWord(&st, 0, 2);
+	_offline_putWord(&st, 1, 2);
+	_offline_putWord(&st, s->ppqn, 2);
+	_offline_putWord(&st, 0x4D54726B, 4);									// MTrk
+	const size_t trackStart = st.length;
+	_offline_putWord(&st, 0, 4);											// length, written at the end
+	
+	// tempo meta event
+	_offline_putVarLen(&st, 0);
+	_offline_putWord(&st, 0xFF5103, 3);
+	_offline_putWord(&st, (uint32_t)(60000000.0 / job->bpm + 0.5), 3);
+	
+	sequencer_play(s);
+	
+	for (uint64_t i = 0; i < clocks && !st.overflow; i++) {
+		sequencer_clock(s);
+		
+		// swapped to chain[position + 1]: arm the one after
+		if (st.swapped) {
+			st.swapped = false;
+			position++;
+			if (position + 1 < job->chain_length) {
+				sequencer_setNextSequenceIndex(s, job->chain[position + 1]);
+			}
+		}
+	}
+	
+	// release what is still held at the end
+	st.tick = s->tick;
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		if (s->triggers[i] != 0) {
+			_offline_putNote(&st, i, 0x00);
+		}
+	}
+	
+	// end of track
+	_offline_putVarLen(&st, 0);
+	_offline_putWord(&st, 0xFF2F00, 3);
+	
+	job->ticks = s->tick;
+	job->elapsed_ns = tempo_now() - start;
+	
+	if (st.overflow) {
+		return -1;
+	}
+	
+	trackLength = st.length - trackStart - 4;
+	for (size_t i = 0; i < 4; i++) {
+		job->buffer[trackStart + i] = (uint8_t)(trackLength >> (8 * (3 - i)));
+	}
+	job->length = st.length;
+	job->checksum = _offline_checksum(job->buffer, job->length);
+	
+	return 1;
+}
+
+int offline_writeFile(const offline_job_t * job, const char * path) {
+	FILE * file;
+	
+	if (job->length == 0) {
+		return -1;
+	}
+	
+	file = fopen(path, "wb");
+	if (file == NULL) {
+		return -1;
+	}
+	
+	const size_t written = fwrite(job->buffer, 1, job->length, file);
+	
+	if (fclose(file) != 0 || written != job->length) {
+		return -1;
+	}
+	
+	return 1;
+}
+
+#if defined(__APPLE__) || defined(__linux__)
+
+int offline_renderParallel(offline_job_t * jobs, size_t count, uint8_t threads) {
+	pthread_t workers[OFFLINE_MAX_THREADS];
+	offline_pool_t pool;
+	uint8_t started = 0;
+	
+	if (threads == 0) {
+		const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = cores > 0 ? (uint8_t)(cores < OFFLINE_MAX_THREADS ? cores : OFFLINE_MAX_THREADS) : 1;
+	}
+	if (threads > OFFLINE_MAX_THREADS) {
+		threads = OFFLINE_MAX_THREADS;
+	}
+	
+	pool.jobs = jobs;
+	pool.count = count;
+	atomic_init(&pool.next, 0);
+	atomic_init(&pool.failed, 0);
+	
+	// the caller is one of the workers
+	for (uint8_t i = 1; i < threads && i < count; i++) {
+		if (pthread_create(&workers[started], NULL, _offline_worker, &pool) == 0) {
+			started++;
+		}
+	}
+	_offline_worker(&pool);
+	
+	for (uint8_t i = 0; i < started; i++) {
+		pthread_join(workers[i], NULL);
+	}
+	
+	return (int)atomic_load(&pool.failed);
+}
+
+#endif
@@ -0,0 +1,57 @@
+//
+//  offline.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#ifndef offline_h
+#define offline_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "sequencer.h"
+
+#define OFFLINE_DEFAULT_BARS		4
+#define OFFLINE_DEFAULT_CHANNEL		9												// GM drums
+#define OFFLINE_DEFAULT_NOTE		36												// trigger 0, one note up per trigger
+#define OFFLINE_VELOCITY			100												// steps without a velocity lane
+#define OFFLINE_MAX_THREADS			64
+
+/*
+*       sequencer_clock() driven by a virtual clock, as fast as the CPU goes: the nth call is
+*       exactly what the clock thread would do at its nth deadline, file ticks are the sequencer's.
+*       Each job works on its own copy of the sequencer and writes a Standard MIDI File
+*       (format 0, the source's ppqn ticks per quarter) into the buffer it was given,
+*       so any number of them render in parallel.
+*/
+
+typedef struct offline_job_t {
+	// input
+	const step_sequencer_t *	source;											// patterns, mutes, direction, divider, swing: copied, never written
+	uint8_t						chain[N_SEQUENCES];								// played in order, each one armed as next_sequence_index
+	uint8_t						chain_length;									// 0: source's current sequence, no swap
+	uint16_t					bars;											// 4/4
+	double						bpm;											// tempo meta event only
+	uint8_t						channel;										// 0-15
+	uint8_t						notes[N_TRIGGERS];
+	uint8_t *					buffer;
+	size_t						capacity;
+	
+	// output
+	size_t						length;											// file bytes, 0: did not fit
+	uint64_t					ticks;											// sequencer ticks rendered
+	uint32_t					events;											// note on + note off
+	uint32_t					checksum;										// FNV-1a of the file, for regression tests
+	uint64_t					elapsed_ns;
+} offline_job_t;
+
+void 				offline_initJob(offline_job_t * job, const step_sequencer_t * source, uint8_t * buffer, size_t capacity);
+int 				offline_render(offline_job_t * job);										//-1 when the file does not fit
+int 				offline_writeFile(const offline_job_t * job, const char * path);
+#if defined(__APPLE__) || defined(__linux__)
+int 				offline_renderParallel(offline_job_t * jobs, size_t count, uint8_t threads);	//threads 0: one per core, returns failed jobs
+#endif
+
+#endif /* offline_h */
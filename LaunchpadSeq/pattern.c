@@ -7,31 +7,27 @@
 
 #include "pattern.h"
 #include <string.h>
+#include "utils.h"
+
+#include "noalloc.h"
 
 void pattern_init(step_pattern_t * p) {
 	pattern_clear(p);
 }
 
 void pattern_clear(step_pattern_t *p) {
-	for (size_t i = 0; i < MAX_STEPS; i++) {
-		p->steps[i] = 0x00;
-		//pattern_setStep(p, i, 0x00);
-	}
-	
-	if (p->pattern_updated_cb != NULL) {
-		p->pattern_updated_cb(p);
-	}
+	p->gates = 0;
 }
 
 int pattern_setStep(step_pattern_t *p, size_t index, uint8_t value) {
-	if (index > MAX_STEPS) {
+	if (index >= MAX_STEPS) {
 		return -1;
 	}
 	
-	p->steps[index] = value;
-	
-	if (p->step_updated_cb != NULL) {
-		p->step_updated_cb(p, index);
+	if (value > 0) {
+		p->gates |= STEP_BIT(index);
+	} else {
+		p->gates &= ~STEP_BIT(index);
 	}
 	
 	return 1;
@@ -42,14 +38,20 @@ int pattern_setSteps(step_pattern_t *p, uint8_t * values, size_t length) {
 		return -1;
 	}
 	
-	memcpy(&p->steps, values, length);
-	
-	if (p->pattern_updated_cb != NULL) {
-		p->pattern_updated_cb(p);
+	p->gates &= ~STEPS_MASK(length);
+	for (size_t i = 0; i < length; i++) {
+		if (values[i] > 0) {
+			p->gates |= STEP_BIT(i);
+		}
 	}
 	
 	return 1;
 }
 
+uint8_t pattern_getStep(const step_pattern_t *p, size_t index) {
+	return index < MAX_STEPS && (p->gates & STEP_BIT(index)) ? STEP_ON : 0x00;
+}
 
-
+uint8_t pattern_countSteps(const step_pattern_t *p, uint8_t length) {
+	return utils_popcount64(p->gates & STEPS_MASK(length));
+}
@@ -13,21 +13,24 @@
 #include <stdint.h>
 
 #define MAX_STEPS                   64
+#define STEP_ON                     0xFF											// value of a set gate
+#define STEP_BIT(index)             (1ULL << (index))
+#define STEPS_MASK(length)          ((length) >= MAX_STEPS ? ~0ULL : STEP_BIT(length) - 1)
 
-typedef struct step_sequence_t step_sequence_t;
+/*
+*       Plain data: change notifications are fired by the sequencer, which knows the indexes
+*/
 
 typedef struct step_pattern_t {
-	uint8_t                     steps[MAX_STEPS];
-	step_sequence_t	*			sequence_ref;
-	
-	void 						(*pattern_updated_cb)(void * p);
-	void 						(*step_updated_cb)(void * p, uint8_t stepIndex);
+	uint64_t                    gates;												// 1 bit per step, step 0 is bit 0
 } step_pattern_t;
 
 void 			pattern_init(step_pattern_t * p);
 void 			pattern_clear(step_pattern_t *p);
 int	 			pattern_setStep(step_pattern_t *p, size_t index, uint8_t value);
 int	 			pattern_setSteps(step_pattern_t *p, uint8_t * values, size_t length);
+uint8_t 		pattern_getStep(const step_pattern_t *p, size_t index);					// STEP_ON or 0
+uint8_t 		pattern_countSteps(const step_pattern_t *p, uint8_t length);				// active steps in [0, length)
 
 
 #endif /* pattern_h */
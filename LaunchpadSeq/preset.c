@@ -0,0 +1,263 @@
+//
+//  preset.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#include "preset.h"
+#include <string.h>
+#include <stddef.h>
+
+#if defined(__APPLE__) || defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "noalloc.h"
+
+// Version 1, before the lanes: read by preset_migrate only
+typedef struct preset_sequence_v1_t {
+	uint64_t					gates[N_TRIGGERS];
+	uint8_t						last_step_indexes[N_TRIGGERS];
+	uint8_t						link_steps;
+	uint8_t						reserved[7];
+} preset_sequence_v1_t;
+
+typedef struct preset_bank_v1_t {
+	uint32_t					magic;
+	uint16_t					version;
+	uint16_t					sequence_count;
+	uint8_t						muted_triggers;
+	uint8_t						reserved[7];
+	preset_sequence_v1_t		sequences[N_SEQUENCES];
+} preset_bank_v1_t;
+
+_Static_assert(sizeof(preset_bank_v1_t) == 16 + 80 * N_SEQUENCES, "preset_bank_v1_t layout");
+
+// 1 step out of 4 ... every step, the first sequence of the factory bank
+const preset_bank_t preset_factory = {
+	.magic = PRESET_MAGIC,
+	.version = PRESET_VERSION,
+	.sequence_count = N_SEQUENCES,
+	.muted_triggers = 0x00,
+	.sequences = {
+		[0] = {
+			.gates = { 0x1111, 0x1010, 0x5555, 0xAAAA, 0xFFFF, 0xEEEE, 0x4444, 0x8888 },
+			.last_step_indexes = { 8, 8, 2, 2, 1, 4, 4, 4 },
+			.link_steps = 0x00,
+			.lanes = { [0 ... N_TRIGGERS - 1] = LANES_DEFAULT }
+		},
+		[1 ... N_SEQUENCES - 1] = {
+			.gates = { 0 },
+			.last_step_indexes = { DEFAULT_STEPS, DEFAULT_STEPS, DEFAULT_STEPS, DEFAULT_STEPS, DEFAULT_STEPS, DEFAULT_STEPS, DEFAULT_STEPS, DEFAULT_STEPS },
+			.link_steps = 0x00,
+			.lanes = { [0 ... N_TRIGGERS - 1] = LANES_DEFAULT }
+		}
+	}
+};
+
+//-----------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------
+
+void preset_initBank(preset_bank_t * b) {
+	memset(b, 0x00, sizeof(*b));
+	b->magic = PRESET_MAGIC;
+	b->version = PRESET_VERSION;
+	b->sequence_count = N_SEQUENCES;
+	
+	for (size_t i = 0; i < N_SEQUENCES; i++) {
+		memset(b->sequences[i].last_step_indexes, DEFAULT_STEPS, sizeof(b->sequences[i].last_step_indexes));
+		for (size_t j = 0; j < N_TRIGGERS; j++) {
+			lanes_init(&b->sequences[i].lanes[j]);
+		}
+	}
+}
+
+int preset_validate(const preset_bank_t * b, size_t size) {
+	if (b == NULL || size < sizeof(*b)) {
+		return -1;
+	}
+	if (b->magic != PRESET_MAGIC || b->version != PRESET_VERSION || b->sequence_count != N_SEQUENCES) {
+		return -1;
+	}
+	
+	// a bad loop length would divide by 0 on the clock thread
+	for (size_t i = 0; i < N_SEQUENCES; i++) {
+		for (size_t j = 0; j < N_TRIGGERS; j++) {
+			const uint8_t last = b->sequences[i].last_step_indexes[j];
+			if (last == 0 || last > MAX_STEPS) {
+				return -1;
+			}
+			// a lane value out of range would reach the outputs as is
+			if (lanes_validate(&b->sequences[i].lanes[j]) < 0) {
+				return -1;
+			}
+		}
+	}
+	
+	return 1;
+}
+
+int preset_migrate(preset_bank_t * b, const void * data, size_t size) {
+	const preset_bank_v1_t * v1 = (const preset_bank_v1_t *)data;
+	
+	if (data == NULL || size < sizeof(*v1) || v1->magic != PRESET_MAGIC || v1->version != 1 || v1->sequence_count != N_SEQUENCES) {
+		return -1;
+	}
+	
+	// the lanes keep their defaults: plays as it did
+	preset_initBank(b);
+	b->muted_triggers = v1->muted_triggers;
+	for (size_t i = 0; i < N_SEQUENCES; i++) {
+		memcpy(b->sequences[i].gates, v1->sequences[i].gates, sizeof(v1->sequences[i].gates));
+		memcpy(b->sequences[i].last_step_indexes, v1->sequences[i].last_step_indexes, sizeof(v1->sequences[i].last_step_indexes));
+		b->sequences[i].link_steps = v1->sequences[i].link_steps;
+	}
+	
+	return preset_validate(b, sizeof(*b));
+}
+
+int preset_loadSequence(const preset_bank_t * b, uint8_t index, step_sequence_t * sq) {
+	if (index >= N_SEQUENCES) {
+		return -1;
+	}
+	
+	const preset_sequence_t * ps = &b->sequences[index];
+	int result = 1;
+	
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		seq_setPattern(sq, i, ps->gates[i], ps->last_step_indexes[i], (ps->link_steps >> i) & 0x01);
+		if (seq_setLanes(sq, i, &ps->lanes[i]) < 0) {
+			result = -1;
+		}
+		
+		// same position in the new loop, the playhead does not jump back to 0
+		sq->current_step_indexes[i] %= sq->last_step_indexes[i];
+	}
+	
+	return result;
+}
+
+int preset_saveSequence(preset_bank_t * b, uint8_t index, const step_sequence_t * sq) {
+	if (index >= N_SEQUENCES) {
+		return -1;
+	}
+	
+	preset_sequence_t * ps = &b->sequences[index];
+	
+	memset(ps, 0x00, sizeof(*ps));
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		ps->gates[i] = sq->patterns[i].gates;
+		ps->last_step_indexes[i] = sq->last_step_indexes[i];
+		ps->link_steps |= (sq->link_steps[i] ? 1 : 0) << i;
+		if (seq_getLanes(sq, i) != NULL) {
+			ps->lanes[i] = *seq_getLanes(sq, i);
+		} else {
+			lanes_init(&ps->lanes[i]);
+		}
+	}
+	
+	return 1;
+}
+
+void preset_save(preset_bank_t * b, step_sequencer_t * s) {
+	preset_initBank(b);
+	
+	for (size_t i = 0; i < N_SEQUENCES; i++) {
+		preset_saveSequence(b, i, sequencer_getSequence(s, i));
+	}
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		b->muted_triggers |= (s->muted_triggers[i] ? 1 : 0) << i;
+	}
+}
+
+#if defined(__APPLE__) || defined(__linux__)
+
+int preset_map(preset_file_t * f, const char * path) {
+	struct stat st;
+	void * data;
+	
+	f->bank = NULL;
+	f->size = 0;
+	f->writable = false;
+	
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		// nothing to lose, anything else may be a bank we cannot read yet
+		f->writable = errno == ENOENT;
+		return f->writable ? 0 : -1;
+	}
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < offsetof(preset_bank_t, sequences)) {
+		close(fd);
+		return -1;
+	}
+	
+	// the mapping outlives the descriptor
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return -1;
+	}
+	
+	// an older version is converted once, the mapping is not needed past that
+	if (((const preset_bank_t *)data)->version < PRESET_VERSION && ((const preset_bank_t *)data)->version >= PRESET_VERSION_OLDEST) {
+		const int migrated = preset_migrate(&f->migrated, data, (size_t)st.st_size);
+		munmap(data, (size_t)st.st_size);
+		if (migrated < 0) {
+			return -1;
+		}
+		f->bank = &f->migrated;
+		f->writable = true;
+		
+		return 1;
+	}
+	
+	if (preset_validate((const preset_bank_t *)data, (size_t)st.st_size) < 0) {
+		munmap(data, (size_t)st.st_size);
+		return -1;
+	}
+	
+	f->bank = (const preset_bank_t *)data;
+	f->size = (size_t)st.st_size;
+	f->writable = true;
+	
+	return 1;
+}
+
+void preset_unmap(preset_file_t * f) {
+	if (f->bank != NULL && f->bank != &f->migrated) {
+		munmap((void *)f->bank, f->size);
+	}
+	f->bank = NULL;
+	f->size = 0;
+	f->writable = false;
+}
+
+int preset_writeFile(const preset_bank_t * b, const char * path) {
+	char tmp[1024];
+	FILE * file;
+	
+	if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) {
+		return -1;
+	}
+	
+	file = fopen(tmp, "wb");
+	if (file == NULL) {
+		return -1;
+	}
+	
+	const size_t written = fwrite(b, 1, sizeof(*b), file);
+	
+	if (fclose(file) != 0 || written != sizeof(*b) || rename(tmp, path) != 0) {
+		unlink(tmp);
+		return -1;
+	}
+	
+	return 1;
+}
+
+#endif
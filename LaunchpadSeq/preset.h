@@ -1,34 +1,72 @@
-#ifndef preset_h
-#define preset_h
-
-typedef struct step_sequence_t step_sequence_t;
-typedef struct step_pattern_t step_pattern_t;
-
-typedef struct ls_sequence_preset_t {
-    uint8_t patterns[8];
-    uint8_t last_steps[8];
-} ls_sequence_preset_t;
-
-const ls_preset_t preset1 = {
-	.patterns = {
-		{0xff, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00},
-		{0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00},
-		{0xff, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00},
-		{0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff},
-		{0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
-		{0x00, 0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff},
-		{0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff, 0x00},
-		{0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff}
-	},
-	.last_steps = {
-		8,
-		8,
-		2,
-		2,
-		1,
-		4,
-		4,
-		4
-	}
-};
-#endif
+//
+//  preset.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 01/10/2023.
+//
+
+#ifndef preset_h
+#define preset_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "sequencer.h"
+
+#define PRESET_MAGIC				0x4B4E4250										// "PBNK" as read by a little endian CPU
+#define PRESET_VERSION				2												// 2: lanes
+#define PRESET_VERSION_OLDEST		1												// still read, converted in memory
+
+/*
+*       Bank file: this struct as it is in memory, little endian, no pointer, no padding.
+*       Nothing to parse: a file is mmap-ed (host) or linked as a const (MCU: stays in flash)
+*       and each sequence is read in place, a fixed size copy away from the sequencer.
+*       A big endian reader fails on the magic. Any layout change bumps PRESET_VERSION and
+*       preset_migrate learns the previous one: an older file is converted once, written back as this one
+*/
+
+typedef struct preset_sequence_t {
+	uint64_t					gates[N_TRIGGERS];								// step_pattern_t.gates
+	uint8_t						last_step_indexes[N_TRIGGERS];					// 1-MAX_STEPS
+	uint8_t						link_steps;										// bit n: trigger n
+	uint8_t						reserved[7];									// 0
+	step_lanes_t				lanes[N_TRIGGERS];								// LANES_DEFAULT when not used
+} preset_sequence_t;
+
+typedef struct preset_bank_t {
+	uint32_t					magic;
+	uint16_t					version;
+	uint16_t					sequence_count;									// N_SEQUENCES
+	uint8_t						muted_triggers;									// bit n: trigger n
+	uint8_t						reserved[7];									// 0
+	preset_sequence_t			sequences[N_SEQUENCES];
+} preset_bank_t;
+
+_Static_assert(sizeof(step_lanes_t) == 4 * MAX_STEPS, "step_lanes_t layout");
+_Static_assert(sizeof(preset_sequence_t) == 80 + sizeof(step_lanes_t) * N_TRIGGERS, "preset_sequence_t layout");
+_Static_assert(sizeof(preset_bank_t) == 16 + sizeof(preset_sequence_t) * N_SEQUENCES, "preset_bank_t layout");
+
+#if defined(__APPLE__) || defined(__linux__)
+typedef struct preset_file_t {
+	const preset_bank_t *		bank;											// read only mapping, NULL when closed
+	size_t						size;
+	bool						writable;										// loaded or missing: may be written back
+	preset_bank_t				migrated;										// bank points here for an older version
+} preset_file_t;
+#endif
+
+extern const preset_bank_t			preset_factory;
+
+void 				preset_initBank(preset_bank_t * b);										// empty sequences, defaults of seq_init
+int 				preset_validate(const preset_bank_t * b, size_t size);						//-1 not a bank of this version
+int 				preset_migrate(preset_bank_t * b, const void * data, size_t size);			//an older version into b, defaults for what it lacks, -1 not one
+int 				preset_loadSequence(const preset_bank_t * b, uint8_t index, step_sequence_t * sq);	//playheads kept in their new loop, -1 lanes the pool had no room for
+int 				preset_saveSequence(preset_bank_t * b, uint8_t index, const step_sequence_t * sq);
+void 				preset_save(preset_bank_t * b, step_sequencer_t * s);							//every sequence and the mutes
+#if defined(__APPLE__) || defined(__linux__)
+int 				preset_map(preset_file_t * f, const char * path);							//0 no such file, -1 unreadable or invalid: never write it back
+void 				preset_unmap(preset_file_t * f);
+int 				preset_writeFile(const preset_bank_t * b, const char * path);				//atomic rename, a mapping of path stays valid
+#endif
+
+#endif /* preset_h */
@@ -0,0 +1,229 @@
+//
+//  reactor.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#include "reactor.h"
+
+#if defined(__linux__)
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include "tempo.h"
+
+#include "noalloc.h"
+
+int _reactor_arm(reactor_source_t * src, uint64_t deadline_ns) {
+	struct itimerspec spec = {0};
+	
+	// a zero it_value disarms the timer
+	if (deadline_ns == 0) {
+		deadline_ns = 1;
+	}
+	src->deadline_ns = deadline_ns;
+	spec.it_value.tv_sec = deadline_ns / 1000000000ULL;
+	spec.it_value.tv_nsec = deadline_ns % 1000000000ULL;
+	
+	return timerfd_settime(src->fd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+int _reactor_add(reactor_t * r, int fd, reactor_source_t ** result) {
+	if (r->source_count >= REACTOR_MAX_SOURCES) {
+		return -1;
+	}
+	
+	reactor_source_t * src = &r->sources[r->source_count];
+	struct epoll_event ev = {0};
+	
+	src->fd = fd;
+	src->write_cb = NULL;
+	ev.events = EPOLLIN;
+	ev.data.ptr = src;
+	if (epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		return -1;
+	}
+	
+	r->source_count++;
+	*result = src;
+	
+	return 1;
+}
+
+void _reactor_fire(reactor_t * r, reactor_source_t * src, uint32_t events) {
+	if (src->fd == r->wake_fd) {
+		uint64_t value;
+		while (read(r->wake_fd, &value, sizeof(value)) > 0) {
+		}
+		return;
+	}
+	
+	if (!src->timer) {
+		if (events & EPOLLOUT && src->write_cb != NULL) {
+			src->write_cb(src->ctx, src->fd);
+		}
+		// readable, hung up or in error: the read tells
+		if (events & ~EPOLLOUT && src->io_cb != NULL) {
+			src->io_cb(src->ctx, src->fd);
+		}
+		return;
+	}
+	
+	uint64_t expirations;
+	if (read(src->fd, &expirations, sizeof(expirations)) < 0) {
+		// spurious, still armed
+		return;
+	}
+	
+	const uint64_t now = tempo_now();
+	if ((int64_t)(now - src->deadline_ns) > r->timer_late_max_ns) {
+		r->timer_late_max_ns = now - src->deadline_ns;
+	}
+	
+	// 0: one shot
+	const uint64_t next = src->timer_cb != NULL ? src->timer_cb(src->ctx, now) : 0;
+	if (next != 0) {
+		_reactor_arm(src, next);
+	}
+}
+
+//-----------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------
+
+int reactor_init(reactor_t * r) {
+	reactor_source_t * src;
+	
+	r->source_count = 0;
+	r->running = false;
+	r->timer_late_max_ns = 0;
+	r->wake_fd = -1;
+	r->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (r->epoll_fd < 0) {
+		return -1;
+	}
+	
+	r->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (r->wake_fd < 0 || _reactor_add(r, r->wake_fd, &src) < 0) {
+		reactor_close(r);
+		return -1;
+	}
+	src->timer = false;
+	src->io_cb = NULL;
+	src->timer_cb = NULL;
+	src->ctx = NULL;
+	
+	return 1;
+}
+
+int reactor_addFd(reactor_t * r, int fd, reactor_io_cb cb, void * ctx) {
+	reactor_source_t * src;
+	
+	if (fd < 0 || _reactor_add(r, fd, &src) < 0) {
+		return -1;
+	}
+	src->timer = false;
+	src->io_cb = cb;
+	src->timer_cb = NULL;
+	src->ctx = ctx;
+	
+	return 1;
+}
+
+int reactor_watchWrite(reactor_t * r, int fd, reactor_io_cb cb) {
+	for (size_t i = 0; i < r->source_count; i++) {
+		reactor_source_t * src = &r->sources[i];
+		struct epoll_event ev = {0};
+		
+		if (src->timer || src->fd != fd) {
+			continue;
+		}
+		if (src->write_cb == cb) {
+			return 1;
+		}
+		ev.events = cb != NULL ? EPOLLIN | EPOLLOUT : EPOLLIN;
+		ev.data.ptr = src;
+		if (epoll_ctl(r->epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+			return -1;
+		}
+		src->write_cb = cb;
+		
+		return 1;
+	}
+	
+	return -1;
+}
+
+int reactor_addTimer(reactor_t * r, uint64_t deadline_ns, reactor_timer_cb cb, void * ctx) {
+	reactor_source_t * src;
+	const int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	
+	if (fd < 0) {
+		return -1;
+	}
+	if (_reactor_add(r, fd, &src) < 0) {
+		close(fd);
+		return -1;
+	}
+	src->timer = true;
+	src->io_cb = NULL;
+	src->timer_cb = cb;
+	src->ctx = ctx;
+	
+	return _reactor_arm(src, deadline_ns) < 0 ? -1 : 1;
+}
+
+int reactor_run(reactor_t * r) {
+	struct epoll_event events[REACTOR_MAX_EVENTS];
+	
+	r->running = true;
+	while (r->running) {
+		const int n = epoll_wait(r->epoll_fd, events, REACTOR_MAX_EVENTS, -1);
+		
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			r->running = false;
+			return -1;
+		}
+		
+		for (int i = 0; i < n && r->running; i++) {
+			_reactor_fire(r, (reactor_source_t *)events[i].data.ptr, events[i].events);
+		}
+	}
+	
+	return 0;
+}
+
+void reactor_stop(reactor_t * r) {
+	const uint64_t value = 1;
+	
+	// write() is async-signal-safe, a full counter already wakes the loop
+	r->running = false;
+	const ssize_t written = write(r->wake_fd, &value, sizeof(value));
+	(void)written;
+}
+
+void reactor_close(reactor_t * r) {
+	for (size_t i = 0; i < r->source_count; i++) {
+		if (r->sources[i].timer) {
+			close(r->sources[i].fd);
+		}
+	}
+	r->source_count = 0;
+	
+	if (r->wake_fd >= 0) {
+		close(r->wake_fd);
+		r->wake_fd = -1;
+	}
+	if (r->epoll_fd >= 0) {
+		close(r->epoll_fd);
+		r->epoll_fd = -1;
+	}
+}
+
+#endif
@@ -0,0 +1,58 @@
+//
+//  reactor.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#ifndef reactor_h
+#define reactor_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__linux__)
+
+#define REACTOR_MAX_SOURCES			16
+#define REACTOR_MAX_EVENTS			8												// per epoll_wait
+
+/*
+*       One thread, one epoll: timers (timerfd, absolute CLOCK_MONOTONIC deadlines, the
+*       tempo_now() time base), MIDI inputs and a wakeup eventfd. Handlers run one after
+*       the other on the reactor thread, nothing they share needs a lock.
+*/
+
+typedef uint64_t (*reactor_timer_cb)(void * ctx, uint64_t now_ns);					// returns the next deadline
+typedef void (*reactor_io_cb)(void * ctx, int fd);
+
+typedef struct reactor_source_t {
+	int							fd;
+	bool						timer;
+	uint64_t					deadline_ns;									// timers: armed deadline
+	reactor_timer_cb			timer_cb;
+	reactor_io_cb				io_cb;
+	reactor_io_cb				write_cb;										// fds: watched for EPOLLOUT when set
+	void *						ctx;
+} reactor_source_t;
+
+typedef struct reactor_t {
+	int							epoll_fd;
+	int							wake_fd;										// eventfd
+	reactor_source_t			sources[REACTOR_MAX_SOURCES];
+	uint8_t						source_count;
+	volatile bool				running;
+	int64_t						timer_late_max_ns;								// worst timer handler start - deadline
+} reactor_t;
+
+int 				reactor_init(reactor_t * r);
+int 				reactor_addFd(reactor_t * r, int fd, reactor_io_cb cb, void * ctx);		//cb when fd is readable
+int 				reactor_watchWrite(reactor_t * r, int fd, reactor_io_cb cb);				//cb when fd is writable, NULL: no longer watched
+int 				reactor_addTimer(reactor_t * r, uint64_t deadline_ns, reactor_timer_cb cb, void * ctx);
+int 				reactor_run(reactor_t * r);												//until reactor_stop()
+void 				reactor_stop(reactor_t * r);											//any thread, signal handlers too
+void 				reactor_close(reactor_t * r);
+
+#endif
+
+#endif /* reactor_h */
@@ -0,0 +1,267 @@
+//
+//  render.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#include "render.h"
+#include <string.h>
+#include "utils.h"
+
+#include "noalloc.h"
+
+void _render_clearDirty(render_queue_t * r) {
+	memset((void *) r->dirty_steps, 0x00, sizeof(r->dirty_steps));
+	memset((void *) r->dirty_patterns, 0x00, sizeof(r->dirty_patterns));
+	r->dirty_triggers = false;
+	r->dirty_state = false;
+	r->dirty_sequence = -1;
+}
+
+void _render_merge(render_queue_t * r, const render_event_t * e) {
+	if (e->type == kRenderEvent_Triggers) {
+		r->dirty_triggers = true;
+		return;
+	}
+	
+	if (e->type == kRenderEvent_Sequence) {
+		r->dirty_sequence = e->sequence_index;
+		r->dirty_state = true;
+		return;
+	}
+	
+	if (e->type == kRenderEvent_State || e->sequence_index >= N_SEQUENCES || e->pattern_index >= N_TRIGGERS) {
+		r->dirty_state = true;
+		return;
+	}
+	
+	uint64_t * steps = &r->dirty_steps[e->sequence_index][e->pattern_index];
+	
+	switch (e->type) {
+		case kRenderEvent_Playhead:
+			if (e->prev_step_index < MAX_STEPS) {
+				*steps |= STEP_BIT(e->prev_step_index);
+			}
+			// fall through
+		case kRenderEvent_Step:
+			if (e->step_index < MAX_STEPS) {
+				*steps |= STEP_BIT(e->step_index);
+			}
+			break;
+		case kRenderEvent_Pattern:
+			r->dirty_patterns[e->sequence_index] |= 1 << e->pattern_index;
+			break;
+		default:
+			break;
+	}
+}
+
+//-----------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------
+
+void render_init(render_queue_t * r) {
+	atomic_init(&r->head, 0);
+	atomic_init(&r->tail, 0);
+	atomic_init(&r->resync, false);
+	atomic_init(&r->input_head, 0);
+	atomic_init(&r->input_tail, 0);
+	r->overflows = 0;
+	r->input_overflows = 0;
+	for (size_t i = 0; i < kRenderOrigin_Count; i++) {
+		atomic_init(&r->origin_ns[i], 0);
+		r->latency[i] = NULL;
+	}
+	r->period_ns = RENDER_DEFAULT_PERIOD_NS;
+	r->running = false;
+	_render_clearDirty(r);
+}
+
+bool render_push(render_queue_t * r, RenderEventType type, uint8_t sequenceIndex, uint8_t patternIndex, uint8_t stepIndex, uint8_t prevStepIndex) {
+	const unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	const unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+	
+	if (head - tail >= RENDER_RING_SIZE) {
+		r->overflows++;
+		atomic_store_explicit(&r->resync, true, memory_order_release);
+		return false;
+	}
+	
+	render_event_t * e = &r->events[head & (RENDER_RING_SIZE - 1)];
+	e->type = type;
+	e->sequence_index = sequenceIndex;
+	e->pattern_index = patternIndex;
+	e->step_index = stepIndex;
+	e->prev_step_index = prevStepIndex;
+	atomic_store_explicit(&r->head, head + 1, memory_order_release);
+	
+	return true;
+}
+
+bool render_pushInput(render_queue_t * r, const SLMIDIPacket * pkt, uint64_t time_ns) {
+	const unsigned head = atomic_load_explicit(&r->input_head, memory_order_relaxed);
+	const unsigned tail = atomic_load_explicit(&r->input_tail, memory_order_acquire);
+	
+	if (head - tail >= RENDER_INPUT_SIZE) {
+		r->input_overflows++;
+		return false;
+	}
+	
+	render_input_t * in = &r->inputs[head & (RENDER_INPUT_SIZE - 1)];
+	in->time_ns = time_ns;
+	in->length = pkt->length < RENDER_INPUT_BYTES ? (uint8_t)pkt->length : RENDER_INPUT_BYTES;
+	memcpy(in->data, pkt->data, in->length);
+	atomic_store_explicit(&r->input_head, head + 1, memory_order_release);
+	
+	return true;
+}
+
+void render_markOrigin(render_queue_t * r, RenderOrigin origin, uint64_t time_ns) {
+	unsigned long long none = 0;
+	
+	// keeps the oldest one, the frame that draws it measures from there
+	if (time_ns != 0) {
+		atomic_compare_exchange_strong_explicit(&r->origin_ns[origin], &none, time_ns, memory_order_relaxed, memory_order_relaxed);
+	}
+}
+
+bool render_process(render_queue_t * r) {
+	uint64_t origins[kRenderOrigin_Count];
+	const bool outer = in_rt_path;
+	
+	in_rt_path = true;
+	// taken before the events: a change marked after this point is measured by the next frame
+	for (size_t i = 0; i < kRenderOrigin_Count; i++) {
+		origins[i] = atomic_exchange_explicit(&r->origin_ns[i], 0, memory_order_relaxed);
+	}
+	
+	unsigned tail = atomic_load_explicit(&r->input_tail, memory_order_relaxed);
+	unsigned head = atomic_load_explicit(&r->input_head, memory_order_acquire);
+	bool drawn = false;
+	
+	// buttons first, the frame shows what they changed
+	while (tail != head) {
+		const render_input_t * in = &r->inputs[tail & (RENDER_INPUT_SIZE - 1)];
+		r->input_packet.timestamp = 0;
+		r->input_packet.length = in->length;
+		memcpy(r->input_packet.data, in->data, in->length);
+		if (r->input_cb != NULL) {
+			r->input_cb(r->ctx, &r->input_packet, in->time_ns);
+		}
+		drawn = true;
+		tail++;
+	}
+	atomic_store_explicit(&r->input_tail, tail, memory_order_release);
+	
+	tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	head = atomic_load_explicit(&r->head, memory_order_acquire);
+	
+	while (tail != head) {
+		_render_merge(r, &r->events[tail & (RENDER_RING_SIZE - 1)]);
+		tail++;
+	}
+	atomic_store_explicit(&r->tail, tail, memory_order_release);
+	
+	if (atomic_exchange_explicit(&r->resync, false, memory_order_acquire)) {
+		r->dirty_state = true;
+	}
+	
+	if (r->dirty_sequence >= 0 && r->sequence_cb != NULL) {
+		r->sequence_cb(r->ctx, (uint8_t)r->dirty_sequence);
+	}
+	
+	if (r->dirty_state) {
+		// redraws everything else too
+		if (r->state_cb != NULL) {
+			r->state_cb(r->ctx);
+		}
+		drawn = true;
+	} else {
+		for (size_t i = 0; i < N_SEQUENCES; i++) {
+			for (size_t j = 0; j < N_TRIGGERS; j++) {
+				if (r->dirty_patterns[i] & (1 << j)) {
+					if (r->pattern_cb != NULL) {
+						r->pattern_cb(r->ctx, i, j);
+					}
+					drawn = true;
+					continue;
+				}
+				
+				uint64_t steps = r->dirty_steps[i][j];
+				while (steps != 0) {
+					const uint8_t stepIndex = utils_lowestBit64(steps);
+					if (r->step_cb != NULL) {
+						r->step_cb(r->ctx, i, j, stepIndex);
+					}
+					steps &= steps - 1;
+					drawn = true;
+				}
+			}
+		}
+		
+		if (r->dirty_triggers) {
+			if (r->triggers_cb != NULL) {
+				r->triggers_cb(r->ctx);
+			}
+			drawn = true;
+		}
+	}
+	
+	if (drawn) {
+		_render_clearDirty(r);
+		if (r->flush_cb != NULL) {
+			r->flush_cb(r->ctx);
+		}
+		for (size_t i = 0; i < kRenderOrigin_Count; i++) {
+			latency_recordSince(r->latency[i], origins[i]);
+		}
+	}
+	in_rt_path = outer;
+	
+	return drawn;
+}
+
+#if defined(__APPLE__) || defined(__linux__)
+
+void * _render_thread(void * arg) {
+	render_queue_t * r = (render_queue_t *)arg;
+	uint64_t deadline = tempo_now();
+	
+	while (r->running) {
+		render_process(r);
+		
+		// fixed frame rate, skip frames rather than catching up
+		deadline += r->period_ns;
+		const uint64_t now = tempo_now();
+		if (deadline < now) {
+			deadline = now;
+		}
+		tempo_sleepUntil(deadline);
+	}
+	
+	return NULL;
+}
+
+int render_start(render_queue_t * r) {
+	if (r->running) {
+		return 0;
+	}
+	
+	// not time critical: a normal thread, the clock preempts it
+	r->running = true;
+	if (pthread_create(&r->thread, NULL, _render_thread, r) != 0) {
+		r->running = false;
+		return -1;
+	}
+	
+	return 1;
+}
+
+void render_stop(render_queue_t * r) {
+	if (r->running) {
+		r->running = false;
+		pthread_join(r->thread, NULL);
+	}
+}
+
+#endif
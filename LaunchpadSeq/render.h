@@ -0,0 +1,111 @@
+//
+//  render.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#ifndef render_h
+#define render_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "sequencer.h"
+#include "tempo.h"
+#include "latency.h"
+#include "midi.h"
+
+#define RENDER_RING_SIZE			128												// power of 2, a tick publishes at most N_TRIGGERS + 3 events
+#define RENDER_DEFAULT_PERIOD_NS	5000000ULL										// 5 ms between two frames
+#define RENDER_INPUT_SIZE			64												// power of 2, device messages between two frames
+#define RENDER_INPUT_BYTES			32												// a device inquiry reply fits, longer SysEx is cut
+
+typedef enum RenderEventType {
+	kRenderEvent_Step = 0,			// one cell changed
+	kRenderEvent_Playhead,			// cursor of one pattern moved from prev_step_index to step_index
+	kRenderEvent_Pattern,			// a whole pattern changed
+	kRenderEvent_Triggers,			// out column
+	kRenderEvent_State,				// full redraw
+	kRenderEvent_Sequence			// sequence_index is played now, the view may follow it
+} RenderEventType;
+
+// What started the changes of a frame, for the latency of their LED messages
+typedef enum RenderOrigin {
+	kRenderOrigin_Tick = 0,			// clock entry
+	kRenderOrigin_Input,			// button received
+	kRenderOrigin_Count
+} RenderOrigin;
+
+typedef struct render_event_t {
+	uint8_t						type;
+	uint8_t						sequence_index;
+	uint8_t						pattern_index;
+	uint8_t						step_index;
+	uint8_t						prev_step_index;
+} render_event_t;
+
+typedef struct render_input_t {
+	uint64_t					time_ns;
+	uint8_t						length;
+	uint8_t						data[RENDER_INPUT_BYTES];
+} render_input_t;
+
+/*
+*       The clock only publishes compact events, the render thread drains them once per frame,
+*       merges them into dirty sets and draws each cell at most once. A full ring is never waited
+*       on: the event is dropped and the next frame is a full redraw.
+*       Messages from the device are handed over the same way: the render thread handles them,
+*       so it is the only one ever writing the Launchpad state.
+*/
+
+// single producer (clock) / single consumer (render thread)
+typedef struct render_queue_t {
+	render_event_t				events[RENDER_RING_SIZE];
+	atomic_uint					head;											// next write, clock thread only
+	atomic_uint					tail;											// next read, render thread only
+	atomic_bool					resync;											// an event was dropped
+	uint32_t					overflows;
+	atomic_ullong				origin_ns[kRenderOrigin_Count];					// oldest change not drawn yet (0: none)
+	latency_histogram_t *		latency[kRenderOrigin_Count];					// origin -> frame flushed
+	
+	// single producer (the device's MIDI thread) / single consumer (render thread)
+	render_input_t				inputs[RENDER_INPUT_SIZE];
+	atomic_uint					input_head;
+	atomic_uint					input_tail;
+	uint32_t					input_overflows;
+	SLMIDIPacket				input_packet;									// render thread only, given to input_cb
+	
+	// coalesced, render thread only
+	uint64_t					dirty_steps[N_SEQUENCES][N_TRIGGERS];
+	uint8_t						dirty_patterns[N_SEQUENCES];					// 1 bit per pattern
+	bool						dirty_triggers;
+	bool						dirty_state;
+	int16_t						dirty_sequence;									// last kRenderEvent_Sequence, -1: none
+	
+	uint64_t					period_ns;
+	volatile bool				running;
+#if defined(__APPLE__) || defined(__linux__)
+	pthread_t					thread;
+#endif
+	
+	void						(*step_cb)(void * ctx, uint8_t sequenceIndex, uint8_t patternIndex, uint8_t stepIndex);
+	void						(*pattern_cb)(void * ctx, uint8_t sequenceIndex, uint8_t patternIndex);
+	void						(*triggers_cb)(void * ctx);
+	void						(*state_cb)(void * ctx);
+	void						(*sequence_cb)(void * ctx, uint8_t sequenceIndex);	// before a full redraw
+	void						(*input_cb)(void * ctx, SLMIDIPacket * pkt, uint64_t time_ns);	// may draw, flushed with the frame
+	void						(*flush_cb)(void * ctx);						// end of a frame that drew something
+	void *						ctx;
+} render_queue_t;
+
+void 				render_init(render_queue_t * r);
+bool 				render_push(render_queue_t * r, RenderEventType type, uint8_t sequenceIndex, uint8_t patternIndex, uint8_t stepIndex, uint8_t prevStepIndex);
+bool 				render_pushInput(render_queue_t * r, const SLMIDIPacket * pkt, uint64_t time_ns);	//device MIDI thread, false when full
+void 				render_markOrigin(render_queue_t * r, RenderOrigin origin, uint64_t time_ns);	//before pushing the events it caused, 0: none
+bool 				render_process(render_queue_t * r);								//drains, coalesces and draws, true if something was drawn
+int 				render_start(render_queue_t * r);
+void 				render_stop(render_queue_t * r);
+
+#endif /* render_h */
@@ -0,0 +1,114 @@
+//
+//  scheduler.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#include "scheduler.h"
+
+#include "noalloc.h"
+
+void scheduler_init(trigger_scheduler_t * s) {
+	atomic_init(&s->head, 0);
+	atomic_init(&s->tail, 0);
+	s->lookahead_ns = SCHEDULER_DEFAULT_LOOKAHEAD_NS;
+	s->stamp_ns = 0;
+	s->origin_ns = 0;
+	s->overflows = 0;
+	s->late_max_ns = 0;
+	s->latency = NULL;
+	s->running = false;
+}
+
+void scheduler_beginTick(trigger_scheduler_t * s, uint64_t tick_ns, uint64_t entry_ns) {
+	s->stamp_ns = tick_ns + s->lookahead_ns;
+	s->origin_ns = entry_ns;
+}
+
+bool scheduler_push(trigger_scheduler_t * s, uint8_t triggerIndex, uint8_t value) {
+	return scheduler_pushAt(s, triggerIndex, value, 0);
+}
+
+bool scheduler_pushAt(trigger_scheduler_t * s, uint8_t triggerIndex, uint8_t value, uint64_t offset_ns) {
+	const unsigned head = atomic_load_explicit(&s->head, memory_order_relaxed);
+	const unsigned tail = atomic_load_explicit(&s->tail, memory_order_acquire);
+	
+	if (head - tail >= SCHEDULER_RING_SIZE) {
+		s->overflows++;
+		return false;
+	}
+	
+	trigger_event_t * e = &s->events[head & (SCHEDULER_RING_SIZE - 1)];
+	e->time_ns = s->stamp_ns + offset_ns;
+	e->origin_ns = s->origin_ns;
+	e->trigger_index = triggerIndex;
+	e->value = value;
+	atomic_store_explicit(&s->head, head + 1, memory_order_release);
+	
+	return true;
+}
+
+uint64_t scheduler_dispatch(trigger_scheduler_t * s, uint64_t now_ns) {
+	unsigned tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+	const unsigned head = atomic_load_explicit(&s->head, memory_order_acquire);
+	
+	// events are pushed in time order
+	while (tail != head) {
+		const trigger_event_t * e = &s->events[tail & (SCHEDULER_RING_SIZE - 1)];
+		
+		if (e->time_ns > now_ns) {
+			atomic_store_explicit(&s->tail, tail, memory_order_release);
+			return e->time_ns;
+		}
+		
+		if ((int64_t)(now_ns - e->time_ns) > s->late_max_ns) {
+			s->late_max_ns = now_ns - e->time_ns;
+		}
+		if (s->dispatch_cb != NULL) {
+			s->dispatch_cb(s->ctx, e->trigger_index, e->value);
+		}
+		latency_recordSince(s->latency, e->origin_ns);
+		tail++;
+	}
+	
+	atomic_store_explicit(&s->tail, tail, memory_order_release);
+	
+	// anything pushed from now on is at least ~lookahead away
+	return now_ns + s->lookahead_ns / 2;
+}
+
+#if defined(__APPLE__) || defined(__linux__)
+
+void * _scheduler_thread(void * arg) {
+	trigger_scheduler_t * s = (trigger_scheduler_t *)arg;
+	
+	while (s->running) {
+		tempo_sleepUntil(scheduler_dispatch(s, tempo_now()));
+	}
+	
+	return NULL;
+}
+
+int scheduler_start(trigger_scheduler_t * s) {
+	if (s->running) {
+		return 0;
+	}
+	
+	s->running = true;
+	if (tempo_createThread(&s->thread, _scheduler_thread, s, SCHEDULER_THREAD_PRIORITY) < 0) {
+		s->running = false;
+		return -1;
+	}
+	
+	return 1;
+}
+
+void scheduler_stop(trigger_scheduler_t * s) {
+	if (s->running) {
+		s->running = false;
+		pthread_join(s->thread, NULL);
+	}
+}
+
+#endif
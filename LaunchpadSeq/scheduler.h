@@ -0,0 +1,65 @@
+//
+//  scheduler.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#ifndef scheduler_h
+#define scheduler_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "tempo.h"
+#include "latency.h"
+
+#define SCHEDULER_RING_SIZE			256												// power of 2, 8 triggers * 2 events * 8 hits (ratchets) * 2 ticks
+#define SCHEDULER_DEFAULT_LOOKAHEAD_NS	5000000ULL									// 5 ms
+#define SCHEDULER_THREAD_PRIORITY	0												// above the clock: it only copies values out
+
+/*
+*       The clock runs the sequencer lookahead_ns early and stamps every trigger change
+*       with the ideal time of its tick + lookahead_ns. The dispatcher outputs them on time,
+*       whatever the clock thread spent on LEDs in between.
+*       A change off the tick (swing, lanes) is pushed with its offset into the tick,
+*       in time order: the dispatcher wakes up for it rather than the clock ticking faster.
+*/
+
+typedef struct trigger_event_t {
+	uint64_t					time_ns;
+	uint64_t					origin_ns;										// clock entry of the tick that pushed it
+	uint8_t						trigger_index;
+	uint8_t						value;
+} trigger_event_t;
+
+// single producer (clock) / single consumer (dispatcher)
+typedef struct trigger_scheduler_t {
+	trigger_event_t				events[SCHEDULER_RING_SIZE];
+	atomic_uint					head;											// next write, clock thread only
+	atomic_uint					tail;											// next read, dispatcher only
+	uint64_t					lookahead_ns;
+	uint64_t					stamp_ns;										// time given to pushed events
+	uint64_t					origin_ns;
+	uint32_t					overflows;
+	int64_t						late_max_ns;									// worst delivery - event time
+	latency_histogram_t *		latency;										// clock entry -> output, lookahead included
+	volatile bool				running;
+#if defined(__APPLE__) || defined(__linux__)
+	pthread_t					thread;
+#endif
+	
+	void						(*dispatch_cb)(void * ctx, uint8_t triggerIndex, uint8_t value);
+	void *						ctx;
+} trigger_scheduler_t;
+
+void 				scheduler_init(trigger_scheduler_t * s);
+void 				scheduler_beginTick(trigger_scheduler_t * s, uint64_t tick_ns, uint64_t entry_ns);	//events pushed until the next call sound at tick_ns + lookahead
+bool 				scheduler_push(trigger_scheduler_t * s, uint8_t triggerIndex, uint8_t value);
+bool 				scheduler_pushAt(trigger_scheduler_t * s, uint8_t triggerIndex, uint8_t value, uint64_t offset_ns);	//offset_ns after the tick's stamp
+uint64_t 			scheduler_dispatch(trigger_scheduler_t * s, uint64_t now_ns);			//outputs due events, returns next wakeup
+int 				scheduler_start(trigger_scheduler_t * s);
+void 				scheduler_stop(trigger_scheduler_t * s);
+
+#endif /* scheduler_h */
@@ -6,56 +6,57 @@
 //
 
 #include "sequence.h"
-#include "sequencer.h"
 #include "utils.h"
+#include <string.h>
 
-void _seq_pattern_step_update_callback(void * pattern, uint8_t stepIndex) {
-	step_pattern_t * p = (step_pattern_t *)pattern;
-	
-	if (p != NULL && p->sequence_ref != NULL) {
-		if (p->sequence_ref->step_updated_cb != NULL) {
-			size_t patternIndex = 0;
-			for (size_t i = 0; i < N_TRIGGERS; i++) {
-				if (p == &p->sequence_ref->patterns[i]) {
-					patternIndex = i;
-					break;
-				}
-			}
-			p->sequence_ref->step_updated_cb(p->sequence_ref, patternIndex, stepIndex);
-		}
+#include "noalloc.h"
+
+// after the gates or the last step of one pattern changed: one test, no scan
+void _seq_summarizePattern(step_sequence_t * s, uint8_t patternIndex) {
+	const uint64_t gates = s->patterns[patternIndex].gates;
+	
+	if (gates != 0) {
+		s->active_patterns |= 1 << patternIndex;
+	} else {
+		s->active_patterns &= ~(1 << patternIndex);
 	}
 }
 
-void _seq_pattern_update_callback(void * pattern) {
-	step_pattern_t * p = (step_pattern_t *)pattern;
-	
-	if (p != NULL && p->sequence_ref != NULL) {
-		if (p->sequence_ref->pattern_updated_cb != NULL) {
-			size_t patternIndex = 0;
-			for (size_t i = 0; i < N_TRIGGERS; i++) {
-				if (p == &p->sequence_ref->patterns[i]) {
-					patternIndex = i;
-					break;
-				}
-			}
-			p->sequence_ref->pattern_updated_cb(p->sequence_ref, patternIndex);
-		}
+// one pattern loop goes from `from` to `to` steps, from 0: not counted yet
+void _seq_moveLength(step_sequence_t * s, uint8_t from, uint8_t to) {
+	if (from > 0 && --s->length_counts[from] == 0) {
+		s->lengths &= ~STEP_BIT(from - 1);
 	}
+	if (s->length_counts[to]++ == 0) {
+		s->lengths |= STEP_BIT(to - 1);
+	}
+	s->length = utils_highestBit64(s->lengths) + 1;
 }
 
-//-----------------------------------------------------------------------------------------
-//-----------------------------------------------------------------------------------------
+// the pattern's lanes back to their defaults: its slot goes back to the pool
+void _seq_releaseLanes(step_sequence_t * s, uint8_t patternIndex) {
+	if (s->lane_slots[patternIndex] != LANE_NO_SLOT) {
+		lanes_release(s->lane_pool, s->lane_slots[patternIndex]);
+		s->lane_slots[patternIndex] = LANE_NO_SLOT;
+	}
+	s->lane_masks[patternIndex] = 0;
+	memset(s->lane_counts[patternIndex], 0x00, sizeof(s->lane_counts[patternIndex]));
+}
 
-void seq_init(step_sequence_t * s) {
+void seq_init(step_sequence_t * s, lane_pool_t * pool) {
 	s->current_pattern_index = 0;
-	s->empty_cpt = 0;
+	s->length = 0;
+	s->active_patterns = 0;
+	s->lengths = 0;
+	memset(s->length_counts, 0x00, sizeof(s->length_counts));
+	memset(s->lane_masks, 0x00, sizeof(s->lane_masks));
+	memset(s->lane_counts, 0x00, sizeof(s->lane_counts));
+	memset(s->lane_slots, LANE_NO_SLOT, sizeof(s->lane_slots));
+	s->lane_pool = pool;
 	
 	for (size_t i = 0; i < N_TRIGGERS; i++) {
 		pattern_init(&s->patterns[i]);
-		s->patterns[i].sequence_ref = s;
-		s->patterns[i].step_updated_cb = _seq_pattern_step_update_callback;
-		s->patterns[i].pattern_updated_cb = _seq_pattern_update_callback;
-		
+		s->last_step_indexes[i] = 0;
 		seq_setLastStepIndex(s, i, DEFAULT_STEPS);
 		seq_linkPatternSteps(s, i, false);
 	}
@@ -79,11 +80,11 @@ void seq_pause(step_sequence_t * s) {
 void seq_clearPattern(step_sequence_t * s, uint8_t patternIndex) {
 	if (patternIndex < N_TRIGGERS) {
 		pattern_clear(&s->patterns[patternIndex]);
+		_seq_summarizePattern(s, patternIndex);
 	}
 }
 
 void seq_clearAllPatterns(step_sequence_t * s) {
-	s->empty_cpt = 0;
 	for (int i = 0; i < N_TRIGGERS; i++) {
 		seq_clearPattern(s, i);
 	}
@@ -102,43 +103,27 @@ void seq_resetCurrentStepIndexes(step_sequence_t * s) {
 }
 
 int seq_setLastStepIndex(step_sequence_t *s, uint8_t patternIndex, uint8_t index) {
-	if (patternIndex >= N_TRIGGERS || index > MAX_STEPS) {
+	// 0 steps: the playhead would loop modulo 0
+	if (patternIndex >= N_TRIGGERS || index == 0 || index > MAX_STEPS) {
 		return -1;
 	}
 	
-	if (s->last_step_indexes[patternIndex] != index) {
-		s->last_step_indexes[patternIndex] = index;
-		
-		if (s->last_step_indexes[patternIndex] > s->length) {
-			s->length = s->last_step_indexes[patternIndex];
-		} else {
-			// find longest
-			s->length = 1;
-			for (size_t i = 0; i < N_TRIGGERS; i++) {
-				if (s->last_step_indexes[patternIndex] > s->length) {
-					s->length = s->last_step_indexes[patternIndex];
-				}
-			}
-		}
-		
-		if (s->pattern_updated_cb != NULL) {
-			s->pattern_updated_cb(s, patternIndex);
-		}
+	if (s->last_step_indexes[patternIndex] == index) {
+		return 0;
 	}
 	
+	_seq_moveLength(s, s->last_step_indexes[patternIndex], index);
+	s->last_step_indexes[patternIndex] = index;
+	_seq_summarizePattern(s, patternIndex);
+	
 	return 1;
 }
 
 int seq_setPatternStepValue(step_sequence_t * s, uint8_t patternIndex, uint8_t stepIndex, uint8_t value) {
 	if (patternIndex < N_TRIGGERS) {
-		if (s->patterns[patternIndex].steps[stepIndex] != value) {
-			// incr/decr cpt to know if the sequence is empty
-			if (value > 0) {
-				s->empty_cpt++;
-			} else {
-				s->empty_cpt--;
-			}
+		if (pattern_getStep(&s->patterns[patternIndex], stepIndex) != (value > 0 ? STEP_ON : 0x00)) {
 			pattern_setStep(&s->patterns[patternIndex], stepIndex, value);
+			_seq_summarizePattern(s, patternIndex);
 			return 1;
 		}
 		return 0;
@@ -147,45 +132,165 @@ int seq_setPatternStepValue(step_sequence_t * s, uint8_t patternIndex, uint8_t s
 	return -1;
 }
 
-void seq_togglePatternStepValue(step_sequence_t * s, uint8_t patternIndex, uint8_t stepIndex) {
+int seq_togglePatternStepValue(step_sequence_t * s, uint8_t patternIndex, uint8_t stepIndex) {
 	if (patternIndex < N_TRIGGERS && stepIndex < MAX_STEPS) {
-		uint8_t curVal = s->patterns[patternIndex].steps[stepIndex];
-		if (curVal) {
-			seq_setPatternStepValue(s, patternIndex, stepIndex, 0);
+		uint8_t curVal = pattern_getStep(&s->patterns[patternIndex], stepIndex);
+		return seq_setPatternStepValue(s, patternIndex, stepIndex, curVal ? 0 : STEP_ON);
+	}
+	
+	return -1;
+}
+
+int seq_setPattern(step_sequence_t * s, uint8_t patternIndex, uint64_t gates, uint8_t lastStepIndex, bool linkSteps) {
+	if (patternIndex >= N_TRIGGERS || lastStepIndex == 0 || lastStepIndex > MAX_STEPS) {
+		return -1;
+	}
+	
+	int result = s->patterns[patternIndex].gates != gates;
+	
+	s->patterns[patternIndex].gates = gates;
+	result |= seq_setLastStepIndex(s, patternIndex, lastStepIndex) > 0;
+	result |= seq_linkPatternSteps(s, patternIndex, linkSteps) > 0;
+	_seq_summarizePattern(s, patternIndex);
+	
+	return result;
+}
+
+int seq_setLaneValue(step_sequence_t * s, uint8_t patternIndex, StepLane lane, uint8_t stepIndex, int value) {
+	if (patternIndex >= N_TRIGGERS || lane >= kStepLane_Count) {
+		return -1;
+	}
+	
+	const int previous = seq_getLaneValue(s, patternIndex, lane, stepIndex);
+	if (previous == value && stepIndex < MAX_STEPS) {
+		return 0;
+	}
+	// the first edited step of the pattern takes a slot
+	if (s->lane_slots[patternIndex] == LANE_NO_SLOT) {
+		s->lane_slots[patternIndex] = lanes_alloc(s->lane_pool);
+		if (s->lane_slots[patternIndex] == LANE_NO_SLOT) {
+			return -1;
+		}
+	}
+	
+	const int result = lanes_setValue(&s->lane_pool->slots[s->lane_slots[patternIndex]], lane, stepIndex, value);
+	
+	if (result > 0) {
+		// off or back to the default: the lane is (no longer) read by the clock
+		const int defaultValue = lanes_default(lane);
+		uint8_t * count = &s->lane_counts[patternIndex][lane];
+		
+		if (previous == defaultValue) {
+			(*count)++;
+		} else if (value == defaultValue) {
+			(*count)--;
+		}
+		if (*count > 0) {
+			s->lane_masks[patternIndex] |= LANE_BIT(lane);
 		} else {
-			seq_setPatternStepValue(s, patternIndex, stepIndex, 255);
+			s->lane_masks[patternIndex] &= ~LANE_BIT(lane);
 		}
 	}
+	if (s->lane_masks[patternIndex] == 0) {
+		_seq_releaseLanes(s, patternIndex);
+	}
+	
+	return result;
+}
+
+int seq_getLaneValue(const step_sequence_t * s, uint8_t patternIndex, StepLane lane, uint8_t stepIndex) {
+	const step_lanes_t * lanes = seq_getLanes(s, patternIndex);
+	
+	if (lanes == NULL) {
+		return lanes_default(lane);
+	}
+	return lanes_getValue(lanes, lane, stepIndex);
+}
+
+const step_lanes_t * seq_getLanes(const step_sequence_t * s, uint8_t patternIndex) {
+	if (patternIndex >= N_TRIGGERS || s->lane_slots[patternIndex] == LANE_NO_SLOT) {
+		return NULL;
+	}
+	return &s->lane_pool->slots[s->lane_slots[patternIndex]];
+}
+
+int seq_setLanes(step_sequence_t * s, uint8_t patternIndex, const step_lanes_t * lanes) {
+	uint8_t mask = 0;
+	
+	if (patternIndex >= N_TRIGGERS) {
+		return -1;
+	}
+	
+	for (size_t i = 0; lanes != NULL && i < kStepLane_Count; i++) {
+		s->lane_counts[patternIndex][i] = lanes_countEdited(lanes, (StepLane)i);
+		if (s->lane_counts[patternIndex][i] > 0) {
+			mask |= LANE_BIT(i);
+		}
+	}
+	// every lane at its default: no slot
+	if (mask == 0) {
+		_seq_releaseLanes(s, patternIndex);
+		return 1;
+	}
+	if (s->lane_slots[patternIndex] == LANE_NO_SLOT) {
+		s->lane_slots[patternIndex] = lanes_alloc(s->lane_pool);
+		if (s->lane_slots[patternIndex] == LANE_NO_SLOT) {
+			_seq_releaseLanes(s, patternIndex);
+			return -1;
+		}
+	}
+	
+	memcpy(&s->lane_pool->slots[s->lane_slots[patternIndex]], lanes, sizeof(*lanes));
+	s->lane_masks[patternIndex] = mask;
+	
+	return 1;
 }
 
-void seq_incrCurrentStepIndexes(step_sequence_t * s, int value) {
-	uint8_t prev[N_TRIGGERS] = {0};
+int seq_copy(step_sequence_t * to, const step_sequence_t * from) {
+	uint8_t slots[N_TRIGGERS];
+	int result = 1;
+	
+	// everything but the slots, which stay to's: its lanes are copied into them
+	memcpy(slots, to->lane_slots, sizeof(slots));
+	memcpy(to, from, sizeof(*to));
+	memcpy(to->lane_slots, slots, sizeof(slots));
 	
 	for (size_t i = 0; i < N_TRIGGERS; i++) {
-		prev[i] = s->current_step_indexes[i];
+		if (seq_setLanes(to, i, seq_getLanes(from, i)) < 0) {
+			result = -1;
+		}
+	}
+	
+	return result;
+}
+
+void seq_incrCurrentStepIndexes(step_sequence_t * s, int value, uint8_t * previous) {
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		if (previous != NULL) {
+			previous[i] = s->current_step_indexes[i];
+		}
 		s->current_step_indexes[i] = utils_circularLoopGetIndex(s->current_step_indexes[i], value, s->last_step_indexes[i]);
 		//s->current_step_indexes[i] = (s->current_step_indexes[i] + value + s->last_step_indexes[i]) % s->last_step_indexes[i]; //circular loop (0 to n)
-		// Update only previous col and current col to avoid a complete grid update (reduces midi traffic)
-		if (s->step_updated_cb != NULL) {
-			s->step_updated_cb(s, i, s->current_step_indexes[i]);
-			s->step_updated_cb(s, i, prev[i]);
-		}
 	}
 }
 
 int seq_linkPatternSteps(step_sequence_t * s, uint8_t patternIndex, bool value) {
-	if (patternIndex > N_TRIGGERS) {
+	if (patternIndex >= N_TRIGGERS) {
 		return -1;
 	}
-	s->link_steps[patternIndex] = value;
 	
-	if (s->pattern_updated_cb != NULL) {
-		s->pattern_updated_cb(s, patternIndex);
+	if (s->link_steps[patternIndex] == value) {
+		return 0;
 	}
+	s->link_steps[patternIndex] = value;
 	
-	return 0;
+	return 1;
+}
+
+bool seq_isEmpty(const step_sequence_t * s) {
+	return s->active_patterns == 0;
 }
 
-bool seq_isEmpty(step_sequence_t * s) {
-	return s->empty_cpt > 0;
+uint8_t seq_length(const step_sequence_t * s) {
+	return s->length;
 }
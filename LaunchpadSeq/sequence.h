@@ -12,12 +12,20 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "pattern.h"
-
-typedef struct step_sequencer_t step_sequencer_t;
+#include "lanes.h"
 
 #define DEFAULT_STEPS               16
 #define N_TRIGGERS                  8
 
+/*
+*       Plain data like step_pattern_t: the seq_* functions report what changed
+*       and the sequencer_* wrappers fire the observers with the indexes.
+*       The summary below is kept by those functions in O(1) per change, so the views
+*       and the clock never scan the steps: anything writing gates or last steps by hand
+*       goes through seq_setPattern. A struct copy copies a valid summary but shares the lane
+*       slots: one sequence into another is seq_copy
+*/
+
 typedef struct step_sequence_t {
 	step_pattern_t              patterns[N_TRIGGERS];          				// N_TRIGGERS triggers with MAX_STEPS steps
 	uint8_t                     last_step_indexes[N_TRIGGERS];
@@ -25,30 +33,41 @@ typedef struct step_sequence_t {
 	
 	uint8_t                     current_pattern_index;
 	volatile uint8_t            current_step_indexes[N_TRIGGERS];
+	uint8_t						length;										// longest last step index
 	
-	step_sequencer_t *			sequencer_ref;
-	uint8_t						length;
-	uint16_t					empty_cpt;									// MAX N_TRIGGERS * MAX_STEPS (8 * 64 = 512)
+	// summary
+	uint8_t						active_patterns;							// bit n: pattern n has a gate set, any step
+	uint8_t						length_counts[MAX_STEPS + 1];				// patterns per last step index
+	uint64_t					lengths;									// bit n: a pattern loops over n + 1 steps
+	uint8_t						lane_masks[N_TRIGGERS];						// bit n: StepLane n has an edited step
+	uint8_t						lane_counts[N_TRIGGERS][kStepLane_Count];	// edited steps
 	
-	void 						(*step_updated_cb)(void * seq, uint8_t patternIndex, uint8_t stepIndex);
-	void 						(*pattern_updated_cb)(void * seq, uint8_t patternIndex);
+	// held for a pattern with lane_masks != 0 only, read for its set gates
+	lane_pool_t *				lane_pool;
+	uint8_t						lane_slots[N_TRIGGERS];						// LANE_NO_SLOT: every lane at its default
 } step_sequence_t;
 
-void 			seq_init(step_sequence_t * s);
+void 			seq_init(step_sequence_t * s, lane_pool_t * pool);								// s holds no slot yet
+int 			seq_copy(step_sequence_t * to, const step_sequence_t * from);					// same pool, playheads included, -1 lanes dropped
 void 			seq_stop(step_sequence_t * s);
 void 			seq_play(step_sequence_t * s);
 void 			seq_pause(step_sequence_t * s);
 
 void 			seq_clearPattern(step_sequence_t * s, uint8_t patternIndex);
 void 			seq_clearAllPatterns(step_sequence_t * s);
-int 			seq_setPatternStepValue(step_sequence_t * s, uint8_t patternIndex, uint8_t stepIndex, uint8_t value);
-void 			seq_togglePatternStepValue(step_sequence_t * s, uint8_t patternIndex, uint8_t stepIndex);
+int 			seq_setPatternStepValue(step_sequence_t * s, uint8_t patternIndex, uint8_t stepIndex, uint8_t value);	// 1 if changed
+int 			seq_togglePatternStepValue(step_sequence_t * s, uint8_t patternIndex, uint8_t stepIndex);
+int 			seq_setPattern(step_sequence_t * s, uint8_t patternIndex, uint64_t gates, uint8_t lastStepIndex, bool linkSteps);	// 1 if changed
+int 			seq_setLaneValue(step_sequence_t * s, uint8_t patternIndex, StepLane lane, uint8_t stepIndex, int value);	// 1 if changed
+int 			seq_getLaneValue(const step_sequence_t * s, uint8_t patternIndex, StepLane lane, uint8_t stepIndex);
+const step_lanes_t *	seq_getLanes(const step_sequence_t * s, uint8_t patternIndex);					// NULL: every lane at its default
+int 			seq_setLanes(step_sequence_t * s, uint8_t patternIndex, const step_lanes_t * lanes);	// whole pattern, from a preset, NULL: defaults, -1 pool full
 
 void 			seq_resetCurrentStepIndexes(step_sequence_t * s);
-int				seq_setLastStepIndex(step_sequence_t *s, uint8_t patternIndex, uint8_t index);
-int 			seq_linkPatternSteps(step_sequence_t * s, uint8_t patternIndex,  bool value);
-bool 			seq_isEmpty(step_sequence_t * s);
-uint8_t 		seq_length(step_sequence_t * s);
-void 			seq_incrCurrentStepIndexes(step_sequence_t * s, int value);
+int				seq_setLastStepIndex(step_sequence_t *s, uint8_t patternIndex, uint8_t index);	// 1 if changed, index 1-MAX_STEPS
+int 			seq_linkPatternSteps(step_sequence_t * s, uint8_t patternIndex,  bool value);	// 1 if changed
+bool 			seq_isEmpty(const step_sequence_t * s);
+uint8_t 		seq_length(const step_sequence_t * s);											// longest pattern loop
+void 			seq_incrCurrentStepIndexes(step_sequence_t * s, int value, uint8_t * previous);	// previous: N_TRIGGERS indexes or NULL
 
 #endif /* sequence_h */
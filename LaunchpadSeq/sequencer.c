@@ -9,6 +9,10 @@
 #include <stdio.h>
 #include <string.h>
 #include "utils.h"
+#include "trace.h"
+#include "preset.h"
+
+#include "noalloc.h"
 
 int sequencer_setTriggerValue(step_sequencer_t* s, size_t index, uint8_t value) {
 	if (index > N_TRIGGERS) {
@@ -18,7 +22,7 @@ int sequencer_setTriggerValue(step_sequencer_t* s, size_t index, uint8_t value)
 	if (s->triggers[index] != value) {
 		s->triggers[index] = value;
 		if (s->trigger_updated_cb != NULL) {
-			s->trigger_updated_cb(s, index);
+			s->trigger_updated_cb(s->ctx, index);
 		}
 		
 		return 1;
@@ -27,37 +31,281 @@ int sequencer_setTriggerValue(step_sequencer_t* s, size_t index, uint8_t value)
 	return 0;
 }
 
-void _sequencer_sequence_step_update_callback(void * sequence, uint8_t patternIndex, uint8_t stepIndex) {
-	step_sequence_t * sq = (step_sequence_t *)sequence;
+void _sequencer_notifyStep(step_sequencer_t * s, uint8_t sequenceIndex, uint8_t patternIndex, uint8_t stepIndex) {
+	if (s->step_updated_cb != NULL) {
+		s->step_updated_cb(s->ctx, sequenceIndex, patternIndex, stepIndex);
+	}
+}
+
+void _sequencer_notifyPattern(step_sequencer_t * s, uint8_t sequenceIndex, uint8_t patternIndex) {
+	if (s->pattern_updated_cb != NULL) {
+		s->pattern_updated_cb(s->ctx, sequenceIndex, patternIndex);
+	}
+}
+
+// waiting for its swap: edits go to the staged copy, the swap redraws it all
+bool _sequencer_isArmed(step_sequencer_t * s, uint8_t sequenceIndex) {
+	return atomic_load_explicit(&s->staging_states[sequenceIndex], memory_order_acquire) == kSequenceStaging_Armed;
+}
+
+uint32_t _sequencer_random(step_sequencer_t * s) {
+	// xorshift32: the state never reaches 0
+	uint32_t x = s->random_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	s->random_state = x;
+	
+	return x;
+}
+
+// what trigger triggerIndex does for step stepIndex, its boundary at tick boundary: swing, then the lanes for a set gate
+void _sequencer_plan(step_sequencer_t * s, const step_sequence_t * sq, uint8_t triggerIndex, uint8_t stepIndex, uint64_t boundary, uint64_t stepNumber, trigger_plan_t * p) {
+	const uint8_t mask = sq->lane_masks[triggerIndex];
+	const step_lanes_t * lanes = mask != 0 ? seq_getLanes(sq, triggerIndex) : NULL;
+	const int32_t ticks = (int32_t)sequencer_stepTicks(s);
+	const uint8_t swing = s->trigger_swings[triggerIndex] != 0 ? s->trigger_swings[triggerIndex] : s->swing;
+	int32_t delay = (stepNumber & 1) ? (swing - SEQUENCER_SWING_STRAIGHT) * 2 * ticks / 100 : 0;
+	uint8_t value = (sq->patterns[triggerIndex].gates >> stepIndex) & 1 ? STEP_ON : 0x00;
+	uint8_t hits = 1;
+	
+	// lanes are loaded for a gate that plays only
+	if (value > 0 && mask != 0) {
+		if ((mask & LANE_BIT(kStepLane_Probability)) && _sequencer_random(s) % LANE_PROBABILITY_ALWAYS >= lanes->probabilities[stepIndex]) {
+			value = 0x00;
+		}
+		if (value > 0 && (mask & LANE_BIT(kStepLane_Velocity))) {
+			value = lanes->velocities[stepIndex];
+		}
+		// to the nearest tick, either way
+		if (value > 0 && (mask & LANE_BIT(kStepLane_Offset))) {
+			const int32_t offset = lanes->offsets[stepIndex] * ticks;
+			delay += offset >= 0 ? (offset + LANE_OFFSET_RESOLUTION / 2) / LANE_OFFSET_RESOLUTION : -((LANE_OFFSET_RESOLUTION / 2 - offset) / LANE_OFFSET_RESOLUTION);
+		}
+		if (value > 0 && (mask & LANE_BIT(kStepLane_Ratchet))) {
+			hits = lanes->ratchets[stepIndex];
+		}
+	}
 	
-	if (sq != NULL && sq->sequencer_ref != NULL) {
-		if (sq->sequencer_ref->step_updated_cb != NULL) {
-			size_t sequenceIndex = 0;
-			for (size_t i = 0; i < N_SEQUENCES; i++) {
-				if (sq == &sq->sequencer_ref->sequences[i]) {
-					sequenceIndex = i;
-					break;
+	// half a step early at most, every hit before the next step
+	if (delay < -ticks / 2) {
+		delay = -ticks / 2;
+	} else if (delay > ticks - 1) {
+		delay = ticks - 1;
+	}
+	p->at = delay >= 0 || boundary >= (uint64_t)-delay ? boundary + delay : 0;
+	if (p->at < s->tick) {
+		p->at = s->tick;
+	}
+	
+	// at most one hit per tick
+	const uint64_t span = boundary + ticks - p->at;
+	if (hits > span) {
+		hits = (uint8_t)span;
+	}
+	p->hits = hits;
+	p->interval = (uint16_t)(span / hits);
+	p->value = value;
+	p->release = !(sq->link_steps[triggerIndex] && value > 0);
+}
+
+void _sequencer_fireHit(step_sequencer_t * s, uint8_t slot, uint8_t triggerIndex) {
+	trigger_plan_t * p = &s->plans[slot][triggerIndex];
+	
+	s->event_tick = p->at;
+	if (!s->muted_triggers[triggerIndex]) {
+		if (p->release) {
+			sequencer_setTriggerValue(s, triggerIndex, 0x00);
+		}
+		sequencer_setTriggerValue(s, triggerIndex, p->value);
+	}
+	
+	// a new note each repeat, even over a linked step
+	p->release = true;
+	if (--p->hits > 0) {
+		p->at += p->interval;
+	} else {
+		s->planned[slot] &= ~(1 << triggerIndex);
+	}
+}
+
+// every hit planned before end, in time order: the host queues them as they come
+void _sequencer_firePlans(step_sequencer_t * s, uint64_t end) {
+	while (true) {
+		uint64_t at = end;
+		
+		for (uint8_t slot = 0; slot < 2; slot++) {
+			for (uint8_t planned = s->planned[slot]; planned != 0; planned &= planned - 1) {
+				const uint8_t i = utils_lowestBit64(planned);
+				if (s->plans[slot][i].at < at) {
+					at = s->plans[slot][i].at;
+				}
+			}
+		}
+		if (at >= end) {
+			return;
+		}
+		
+		for (uint8_t slot = 0; slot < 2; slot++) {
+			for (uint8_t planned = s->planned[slot]; planned != 0; planned &= planned - 1) {
+				const uint8_t i = utils_lowestBit64(planned);
+				if (s->plans[slot][i].at == at) {
+					_sequencer_fireHit(s, slot, i);
 				}
 			}
-			sq->sequencer_ref->step_updated_cb(sq->sequencer_ref, sequenceIndex, patternIndex, stepIndex);
 		}
 	}
 }
 
-void _sequencer_sequence_pattern_update_callback(void * sequence, uint8_t patternIndex) {
-	step_sequence_t * sq = (step_sequence_t *)sequence;
+// an early offset is heard before its boundary: the next step of those triggers is planned one step ahead
+void _sequencer_planEarly(step_sequencer_t * s, const step_sequence_t * sq, uint64_t boundary) {
+	const uint64_t next = boundary + sequencer_stepTicks(s);
+	const uint8_t slot = (s->step_count + 1) & 1;
+	const int dir = s->current_direction == kDirection_Forward ? 1 : -1;
+	uint8_t offsets = 0;
+	
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		offsets |= ((sq->lane_masks[i] >> kStepLane_Offset) & 1) << i;
+	}
 	
-	if (sq != NULL && sq->sequencer_ref != NULL) {
-		if (sq->sequencer_ref->pattern_updated_cb != NULL) {
-			size_t sequenceIndex = 0;
-			for (size_t i = 0; i < N_SEQUENCES; i++) {
-				if (sq == &sq->sequencer_ref->sequences[i]) {
-					sequenceIndex = i;
-					break;
+	// the next step may come from another copy or sequence
+	if (offsets == 0 || s->next_sequence_index != NO_NEXT_SEQUENCE
+		|| atomic_load_explicit(&s->staging_states[s->current_sequence_index], memory_order_acquire) == kSequenceStaging_Armed) {
+		return;
+	}
+	
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		const uint8_t stepIndex = utils_circularLoopGetIndex(sq->current_step_indexes[i], dir, sq->last_step_indexes[i]);
+		
+		if (!((offsets >> i) & 1) || s->muted_triggers[i]
+			|| !((sq->patterns[i].gates >> stepIndex) & 1) || seq_getLanes(sq, i)->offsets[stepIndex] >= 0) {
+			continue;
+		}
+		
+		trigger_plan_t * p = &s->plans[slot][i];
+		_sequencer_plan(s, sq, i, stepIndex, next, s->step_count + 1, p);
+		s->planned[slot] |= 1 << i;
+		s->planned_early |= 1 << i;
+		
+		// what is left of the current step stops at the early one
+		trigger_plan_t * current = &s->plans[slot ^ 1][i];
+		if ((s->planned[slot ^ 1] >> i) & 1) {
+			if (current->at >= p->at) {
+				s->planned[slot ^ 1] &= ~(1 << i);
+			} else if (current->at + (uint64_t)(current->hits - 1) * current->interval >= p->at) {
+				current->hits = (uint8_t)((p->at - current->at + current->interval - 1) / current->interval);
+			}
+		}
+	}
+}
+
+// boundary of step s->step_count, the playheads on it
+void _sequencer_playStep(step_sequencer_t * s, const step_sequence_t * sq, uint64_t boundary) {
+	const uint8_t slot = s->step_count & 1;
+	
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		const uint8_t bit = 1 << i;
+		trigger_plan_t * p = &s->plans[slot][i];
+		
+		// played from the previous step
+		if (s->planned_early & bit) {
+			s->planned_early &= ~bit;
+			continue;
+		}
+		
+		s->event_tick = boundary;
+		if (s->muted_triggers[i]) {
+			sequencer_setTriggerValue(s, i, 0x00);
+			continue;
+		}
+		
+		const size_t resolvedNextIndex = utils_circularLoopGetIndex(sq->current_step_indexes[i], 0, sq->last_step_indexes[i]);
+		const uint8_t swing = s->trigger_swings[i] != 0 ? s->trigger_swings[i] : s->swing;
+		
+		// a plain gate on the grid: nothing to plan
+		if (sq->lane_masks[i] == 0 && (!(s->step_count & 1) || swing == SEQUENCER_SWING_STRAIGHT)) {
+			p->value = (sq->patterns[i].gates >> resolvedNextIndex) & 1 ? STEP_ON : 0x00;
+			p->release = !(sq->link_steps[i] && p->value > 0);
+			p->at = boundary;
+			p->hits = 1;
+		} else {
+			_sequencer_plan(s, sq, i, resolvedNextIndex, boundary, s->step_count, p);
+		}
+		
+		// on the boundary, a single hit: played now, nothing kept
+		if (p->at == boundary && p->hits == 1) {
+			// check if we need to "noteOff" this step by comparing to next index value
+			// reset otherwise (spike)
+			if (p->release) {
+				sequencer_setTriggerValue(s, i, 0x00);
+			}
+			sequencer_setTriggerValue(s, i, p->value);
+			s->planned[slot] &= ~bit;
+		} else {
+			s->planned[slot] |= bit;
+		}
+	}
+}
+
+bool _sequencer_isSwapBoundary(step_sequencer_t * s, uint8_t sequenceIndex, uint32_t stepCpt) {
+	const step_sequence_t * sq = sequencer_getSequence(s, sequenceIndex);
+	const uint8_t position = sq->length > 0 ? stepCpt % sq->length : 0;
+	
+	// not heard: any step will do
+	if (s->current_state != kSequencerState_Playing || sequenceIndex != s->current_sequence_index) {
+		return true;
+	}
+	
+	switch ((SwapQuantize)s->staging_quantize[sequenceIndex]) {
+		case kSwapQuantize_Beat:
+			return position % 4 == 0;
+		case kSwapQuantize_Bar:
+			return position % 16 == 0;
+		case kSwapQuantize_Sequence:
+			return position == 0;
+		default:
+			return true;
+	}
+}
+
+void _sequencer_swapStaging(step_sequencer_t * s, uint32_t stepCpt) {
+	bool swapped = false;
+	
+	for (size_t i = 0; i < N_SEQUENCES; i++) {
+		if (atomic_load_explicit(&s->staging_states[i], memory_order_acquire) != kSequenceStaging_Armed
+			|| !_sequencer_isSwapBoundary(s, i, stepCpt)) {
+			continue;
+		}
+		
+		const uint8_t live = atomic_load_explicit(&s->live_banks[i], memory_order_relaxed);
+		const step_sequence_t * from = &s->banks[live][i];
+		step_sequence_t * to = &s->banks[live ^ 1][i];
+		
+		// the playheads go on where they are, in the new loops
+		to->current_pattern_index = from->current_pattern_index;
+		for (size_t j = 0; j < N_TRIGGERS; j++) {
+			to->current_step_indexes[j] = from->current_step_indexes[j] % to->last_step_indexes[j];
+		}
+		
+		atomic_store_explicit(&s->live_banks[i], live ^ 1, memory_order_release);
+		atomic_store_explicit(&s->staging_states[i], kSequenceStaging_Idle, memory_order_release);
+		trace_write(s->trace, kTraceEvent_Staging, i, live ^ 1, 0, 0);
+		
+		if (i == s->current_sequence_index) {
+			const int mutes = atomic_exchange_explicit(&s->staged_mutes, -1, memory_order_acquire);
+			for (size_t j = 0; mutes >= 0 && j < N_TRIGGERS; j++) {
+				const bool muted = (mutes >> j) & 0x01;
+				if (s->muted_triggers[j] != muted) {
+					sequencer_setMutedPattern(s, j, muted);
 				}
 			}
-			sq->sequencer_ref->pattern_updated_cb(sq->sequencer_ref, sequenceIndex, patternIndex);
 		}
+		swapped = true;
+	}
+	
+	// one redraw for however many sequences were swapped
+	if (swapped && s->state_updated_cb != NULL) {
+		s->state_updated_cb(s->ctx);
 	}
 }
 
@@ -66,22 +314,36 @@ void _sequencer_sequence_pattern_update_callback(void * sequence, uint8_t patter
 
 void sequencer_init(step_sequencer_t * s) {
 	s->current_sequence_index = 0;
-	s->clock_cpt = 0;
 	s->clock_divider = 1;
+	s->tick = 0;
+	s->step_tick = 0;
+	s->step_count = 0;
+	s->event_tick = 0;
+	s->step_cpt = 0;
+	s->ppqn = SEQUENCER_DEFAULT_PPQN;
+	s->swing = SEQUENCER_SWING_STRAIGHT;
+	memset(s->trigger_swings, 0, sizeof(s->trigger_swings));
 	s->current_state = kSequencerState_Stopped;
 	s->current_direction = kDirection_Forward;
-
+	
 	sequencer_setNextSequenceIndex(s, NO_NEXT_SEQUENCE);
 	
 	memset((void *) s->triggers, 0x00, sizeof(s->triggers));
 	memset((void *) s->muted_triggers, false, sizeof(s->muted_triggers));
+	memset(s->planned, 0, sizeof(s->planned));
+	s->planned_early = 0;
+	s->random_state = SEQUENCER_RANDOM_SEED;
+	s->trace = NULL;
+	s->ctx = s;
 	
+	atomic_init(&s->staged_mutes, -1);
+	lanes_initPool(&s->lane_pool);
 	for (size_t i = 0; i < N_SEQUENCES; i++) {
-		seq_init(&s->sequences[i]);
-		//TODO: load preset for seq 0
-		s->sequences[i].sequencer_ref = s;
-		s->sequences[i].step_updated_cb = _sequencer_sequence_step_update_callback;
-		s->sequences[i].pattern_updated_cb = _sequencer_sequence_pattern_update_callback;		
+		seq_init(&s->banks[0][i], &s->lane_pool);
+		seq_init(&s->banks[1][i], &s->lane_pool);
+		atomic_init(&s->live_banks[i], 0);
+		atomic_init(&s->staging_states[i], kSequenceStaging_Idle);
+		s->staging_quantize[i] = kSwapQuantize_Step;
 	}
 }
 
@@ -101,51 +363,50 @@ int sequencer_setSequenceIndex(step_sequencer_t * s, uint8_t sequenceIndex) {
 	s->current_sequence_index = sequenceIndex;
 	
 	if (s->sequence_index_updated_cb != NULL) {
-		s->sequence_index_updated_cb(s, sequenceIndex);
+		s->sequence_index_updated_cb(s->ctx, sequenceIndex);
 	}
 	
 	return 1;
 }
 
-void sequencer_clock(step_sequencer_t * s) {
-	//TODO: we will probably miss the first step
-	s->clock_cpt++;
+void _sequencer_step(step_sequencer_t * s) {
+	const uint32_t stepCpt = s->step_cpt;
+	const uint64_t boundary = s->step_tick;
 	
-	// Block further instructions
-	if (s->clock_cpt % (DEFAULT_CLOCK_DIVIDER * s->clock_divider) != 0) {
-		return;
-	}
+	s->step_cpt = stepCpt + 1;
+	
+	// staged copies become live before the step is read from them
+	_sequencer_swapStaging(s, stepCpt);
 	
 	if (s->current_state != kSequencerState_Playing) {
 		return;
 	}
 	
-	uint8_t stepCpt = s->clock_cpt / (DEFAULT_CLOCK_DIVIDER);
 	step_sequence_t * sq = sequencer_getCurrentSequence(s);
 	int dir = s->current_direction == kDirection_Forward ? 1 : -1;
-
-	printf("seq: %d; step: %d\n", s->current_sequence_index ,stepCpt);
-
+	
+	trace_write(s->trace, kTraceEvent_Step, s->current_sequence_index, (uint8_t)stepCpt, 0, 0);
+	
 	//auto play next seq
 	if (s->next_sequence_index != NO_NEXT_SEQUENCE && s->next_sequence_index < N_SEQUENCES) {
 		bool goToNextSequence = false;
-				
+		
 		if (dir == 1 && stepCpt >= sq->length) {
 			goToNextSequence = true;
-		} else if (dir == -1 && s->clock_cpt % sq->length == 0) {
+		} else if (dir == -1 && stepCpt % sq->length == 0) {
 			goToNextSequence = true;
 		}
 		
 		if (goToNextSequence) {
-			printf("Swap to %d\n", s->next_sequence_index);
-
+			trace_write(s->trace, kTraceEvent_SequenceSwap, s->current_sequence_index, (uint8_t)s->next_sequence_index, 0, 0);
+			
 			if (sequencer_setSequenceIndex(s, s->next_sequence_index) > 0) {
 				sequencer_resetCurrentStepIndexes(s, (uint8_t)s->current_sequence_index);
 				sequencer_setNextSequenceIndex(s, NO_NEXT_SEQUENCE);
 				//do not go step + 1
 				//or go last step if backward
 				dir = dir > 0 ? 0 : -1;
-				s->clock_cpt = 0;
+				s->step_cpt = 1;
 			}
 		}
 	}
@@ -155,37 +416,49 @@ void sequencer_clock(step_sequencer_t * s) {
 	// update sequence's patterns indexes
 	// incr/retain/decr cur sequence index
 	// value can be positive or negative
-	seq_incrCurrentStepIndexes(sq, dir);
-		
+	uint8_t prev[N_TRIGGERS];
+	seq_incrCurrentStepIndexes(sq, dir, prev);
+	
+	// Update only previous col and current col to avoid a complete grid update (reduces midi traffic)
 	for (size_t i = 0; i < N_TRIGGERS; i++) {
-		const bool muted = s->muted_triggers[i];
-		const size_t resolvedNextIndex = utils_circularLoopGetIndex(sq->current_step_indexes[i], 0, sq->last_step_indexes[i]);
-		const uint8_t value = sq->patterns[i].steps[resolvedNextIndex];
-
-		if (muted) {
-			sequencer_setTriggerValue(s, i, 0x00);
+		if (s->playhead_updated_cb != NULL) {
+			s->playhead_updated_cb(s->ctx, s->current_sequence_index, i, prev[i], sq->current_step_indexes[i]);
 		} else {
-			// check if we need to "noteOff" this step by comparing to next index value
-			// reset otherwise (spike)
-			// TODO: might find a better way with millis for reset
-			if (!(sequencer_getCurrentSequence(s)->link_steps[i] && value > 0)) {
-				sequencer_setTriggerValue(s, i, 0x00);
-			}
-			
-			//const uint8_t value = sq->patterns[i].steps[sq->current_step_indexes[i]];
-			sequencer_setTriggerValue(s, i, value);
+			_sequencer_notifyStep(s, s->current_sequence_index, i, sq->current_step_indexes[i]);
+			_sequencer_notifyStep(s, s->current_sequence_index, i, prev[i]);
 		}
 	}
 	
-	//TODO: reset to 0 after DEFAULT_CLOCK_DIVIDER * MAX_STTEPS because 3 is odd number uint8_t will not be enough
+	_sequencer_playStep(s, sq, boundary);
+	_sequencer_planEarly(s, sq, boundary);
+	s->step_count++;
+	
+	// the loop point counts as its length, then back to the second step
 	if (stepCpt > sq->length - 1) {
-		s->clock_cpt = 0;
+		s->step_cpt = 1;
 	}
 	
 	//TODO: check if really needed
 	if (s->triggers_updated_cb != NULL) {
-		s->triggers_updated_cb(s);
+		s->triggers_updated_cb(s->ctx);
+	}
+}
+
+void sequencer_clock(step_sequencer_t * s) {
+	const uint64_t end = s->tick + sequencer_ticksPerClock(s);
+	
+	if (s->step_tick < end) {
+		_sequencer_step(s);
+		s->step_tick += sequencer_stepTicks(s);
+	}
+	
+	// swung, offset and repeated hits of this window
+	if ((s->planned[0] | s->planned[1]) != 0) {
+		_sequencer_firePlans(s, end);
 	}
+	
+	s->tick = end;
+	s->event_tick = end;
 }
 
 int sequencer_setNextSequenceIndex(step_sequencer_t * s, int8_t sequenceIndex) {
@@ -200,7 +473,7 @@ int sequencer_setNextSequenceIndex(step_sequencer_t * s, int8_t sequenceIndex) {
 	s->next_sequence_index = sequenceIndex;
 	
 	if (s->next_seq_index_updated_cb != NULL) {
-		s->next_seq_index_updated_cb(s);
+		s->next_seq_index_updated_cb(s->ctx);
 	}
 	
 	return 1;
@@ -209,10 +482,12 @@ int sequencer_setNextSequenceIndex(step_sequencer_t * s, int8_t sequenceIndex) {
 void sequencer_stop(step_sequencer_t * s) {
 	if (s->current_state != kSequencerState_Stopped) {
 		seq_resetCurrentStepIndexes(sequencer_getCurrentSequence(s));
-	
+		memset(s->planned, 0, sizeof(s->planned));
+		s->planned_early = 0;
+		
 		s->current_state = kSequencerState_Stopped;
 		if (s->state_updated_cb != NULL) {
-			s->state_updated_cb(s);
+			s->state_updated_cb(s->ctx);
 		}
 	}
 }
@@ -221,7 +496,7 @@ void sequencer_play(step_sequencer_t * s) {
 	if (s->current_state != kSequencerState_Playing) {
 		s->current_state = kSequencerState_Playing;
 		if (s->state_updated_cb != NULL) {
-			s->state_updated_cb(s);
+			s->state_updated_cb(s->ctx);
 		}
 	}
 }
@@ -230,17 +505,20 @@ void sequencer_pause(step_sequencer_t * s) {
 	if (s->current_state != kSequencerState_Paused) {
 		s->current_state = kSequencerState_Paused;
 		if (s->state_updated_cb != NULL) {
-			s->state_updated_cb(s);
+			s->state_updated_cb(s->ctx);
 		}
 	}
 }
 
 void sequencer_clearPattern(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex) {
-	if (sequence_index >= N_SEQUENCES) {
+	if (sequence_index >= N_SEQUENCES || patternIndex >= N_TRIGGERS) {
 		return;
 	}
 	
-	seq_clearPattern(&s->sequences[sequence_index], patternIndex);
+	seq_clearPattern(sequencer_getEditedSequence(s, sequence_index), patternIndex);
+	if (!_sequencer_isArmed(s, sequence_index)) {
+		_sequencer_notifyPattern(s, sequence_index, patternIndex);
+	}
 }
 
 void sequencer_clearAllPatterns(step_sequencer_t * s, uint8_t sequence_index) {
@@ -248,7 +526,7 @@ void sequencer_clearAllPatterns(step_sequencer_t * s, uint8_t sequence_index) {
 		return;
 	}
 	
-	for (size_t i = 0; i < N_SEQUENCES; i++) {
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
 		sequencer_clearPattern(s, sequence_index, i);
 	}
 	//TODO: update grid ?
@@ -263,28 +541,206 @@ void sequencer_clearAllPatterns(step_sequencer_t * s, uint8_t sequence_index) {
 
 void sequencer_resetCurrentStepIndexes(step_sequencer_t * s, uint8_t sequence_index) {
 	if (sequence_index < N_SEQUENCES) {
-		seq_resetCurrentStepIndexes(&s->sequences[sequence_index]);
+		seq_resetCurrentStepIndexes(sequencer_getSequence(s, sequence_index));
 		
 		//TODO: add specific cb
 		if (s->state_updated_cb != NULL) {
-			s->state_updated_cb(s);
+			s->state_updated_cb(s->ctx);
 		}
 	}
 }
 
-void sequencer_setPatternStepValue(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex, uint8_t stepIndex, uint8_t value) {
-	if (sequence_index < N_SEQUENCES) {
-		seq_setPatternStepValue(&s->sequences[sequence_index], patternIndex, stepIndex, value);
-		if (s->step_updated_cb != NULL) {
-			s->step_updated_cb(s, sequence_index, patternIndex, stepIndex);
+void sequencer_locate(step_sequencer_t * s, uint16_t step) {
+	step_sequence_t * sq = sequencer_getCurrentSequence(s);
+	const uint8_t length = sq->length > 0 ? sq->length : 1;
+	
+	// one step before: the next step boundary moves every pattern to step
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		sq->current_step_indexes[i] = utils_circularLoopGetIndex(step % sq->last_step_indexes[i], -1, sq->last_step_indexes[i]);
+	}
+	s->step_tick = s->tick;
+	s->step_cpt = step % length;
+	s->step_count = step;
+	memset(s->planned, 0, sizeof(s->planned));
+	s->planned_early = 0;
+	
+	if (s->state_updated_cb != NULL) {
+		s->state_updated_cb(s->ctx);
+	}
+}
+
+int sequencer_load(step_sequencer_t * s, const preset_bank_t * bank) {
+	if (bank == NULL) {
+		return -1;
+	}
+	
+	int result = 1;
+	
+	// fixed size copies, a whole bank fits in a step
+	for (size_t i = 0; i < N_SEQUENCES; i++) {
+		if (preset_loadSequence(bank, i, sequencer_getSequence(s, i)) < 0) {
+			result = -1;
 		}
 	}
+	for (size_t i = 0; i < N_TRIGGERS; i++) {
+		const bool muted = (bank->muted_triggers >> i) & 0x01;
+		if (s->muted_triggers[i] != muted) {
+			sequencer_setMutedPattern(s, i, muted);
+		}
+	}
+	
+	// everything may have changed: one full redraw
+	if (s->state_updated_cb != NULL) {
+		s->state_updated_cb(s->ctx);
+	}
+	
+	return result;
 }
 
-void sequencer_togglePatternStepValue(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex, uint8_t stepIndex) {
-	if (sequence_index < N_SEQUENCES) {
-		seq_togglePatternStepValue(&s->sequences[sequence_index], patternIndex, stepIndex);
+bool sequencer_isStepBoundary(step_sequencer_t * s) {
+	if (s->current_state != kSequencerState_Playing) {
+		return true;
+	}
+	
+	return s->step_tick < s->tick + sequencer_ticksPerClock(s);
+}
+
+int sequencer_setPpqn(step_sequencer_t * s, uint16_t ppqn) {
+	if (ppqn < SEQUENCER_DEFAULT_PPQN || ppqn > SEQUENCER_MAX_PPQN || ppqn % SEQUENCER_CLOCK_PPQN != 0) {
+		return -1;
+	}
+	
+	if (s->ppqn == ppqn) {
+		return 0;
+	}
+	
+	// both on clock ticks: exact at the new resolution, the hits in flight are dropped
+	s->tick = s->tick / s->ppqn * ppqn + s->tick % s->ppqn * ppqn / s->ppqn;
+	s->step_tick = s->step_tick / s->ppqn * ppqn + s->step_tick % s->ppqn * ppqn / s->ppqn;
+	s->event_tick = s->tick;
+	s->ppqn = ppqn;
+	memset(s->planned, 0, sizeof(s->planned));
+	s->planned_early = 0;
+	
+	return 1;
+}
+
+int sequencer_setSwing(step_sequencer_t * s, uint8_t swing) {
+	if (swing < SEQUENCER_SWING_STRAIGHT || swing > SEQUENCER_SWING_MAX) {
+		return -1;
+	}
+	
+	if (s->swing == swing) {
+		return 0;
+	}
+	
+	s->swing = swing;
+	
+	return 1;
+}
+
+int sequencer_setTriggerSwing(step_sequencer_t * s, uint8_t triggerIndex, uint8_t swing) {
+	if (triggerIndex >= N_TRIGGERS || (swing != 0 && (swing < SEQUENCER_SWING_STRAIGHT || swing > SEQUENCER_SWING_MAX))) {
+		return -1;
+	}
+	
+	if (s->trigger_swings[triggerIndex] == swing) {
+		return 0;
 	}
+	
+	s->trigger_swings[triggerIndex] = swing;
+	
+	return 1;
+}
+
+uint16_t sequencer_ticksPerClock(const step_sequencer_t * s) {
+	return s->ppqn / SEQUENCER_CLOCK_PPQN;
+}
+
+uint32_t sequencer_stepTicks(const step_sequencer_t * s) {
+	return (uint32_t)(s->ppqn / 4) * s->clock_divider;
+}
+
+uint64_t sequencer_eventOffset(const step_sequencer_t * s) {
+	return s->event_tick > s->tick ? s->event_tick - s->tick : 0;
+}
+
+int sequencer_setPatternStepValue(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex, uint8_t stepIndex, uint8_t value) {
+	if (sequence_index >= N_SEQUENCES) {
+		return -1;
+	}
+	
+	int result = seq_setPatternStepValue(sequencer_getEditedSequence(s, sequence_index), patternIndex, stepIndex, value);
+	if (result > 0 && !_sequencer_isArmed(s, sequence_index)) {
+		_sequencer_notifyStep(s, sequence_index, patternIndex, stepIndex);
+	}
+	
+	return result;
+}
+
+int sequencer_togglePatternStepValue(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex, uint8_t stepIndex) {
+	if (sequence_index >= N_SEQUENCES) {
+		return -1;
+	}
+	
+	int result = seq_togglePatternStepValue(sequencer_getEditedSequence(s, sequence_index), patternIndex, stepIndex);
+	if (result > 0 && !_sequencer_isArmed(s, sequence_index)) {
+		_sequencer_notifyStep(s, sequence_index, patternIndex, stepIndex);
+	}
+	
+	return result;
+}
+
+int sequencer_setLastStepIndex(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex, uint8_t index) {
+	if (sequence_index >= N_SEQUENCES) {
+		return -1;
+	}
+	
+	int result = seq_setLastStepIndex(sequencer_getEditedSequence(s, sequence_index), patternIndex, index);
+	if (result > 0 && !_sequencer_isArmed(s, sequence_index)) {
+		_sequencer_notifyPattern(s, sequence_index, patternIndex);
+	}
+	
+	return result;
+}
+
+int sequencer_linkPatternSteps(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex, bool value) {
+	if (sequence_index >= N_SEQUENCES) {
+		return -1;
+	}
+	
+	int result = seq_linkPatternSteps(sequencer_getEditedSequence(s, sequence_index), patternIndex, value);
+	if (result > 0 && !_sequencer_isArmed(s, sequence_index)) {
+		_sequencer_notifyPattern(s, sequence_index, patternIndex);
+	}
+	
+	return result;
+}
+
+int sequencer_setPattern(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex, uint64_t gates, uint8_t lastStepIndex, bool linkSteps) {
+	if (sequence_index >= N_SEQUENCES || patternIndex >= N_TRIGGERS) {
+		return -1;
+	}
+	
+	int result = seq_setPattern(sequencer_getEditedSequence(s, sequence_index), patternIndex, gates, lastStepIndex, linkSteps);
+	if (result > 0 && !_sequencer_isArmed(s, sequence_index)) {
+		_sequencer_notifyPattern(s, sequence_index, patternIndex);
+	}
+	
+	return result;
+}
+
+int sequencer_setLaneValue(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex, StepLane lane, uint8_t stepIndex, int value) {
+	if (sequence_index >= N_SEQUENCES) {
+		return -1;
+	}
+	
+	int result = seq_setLaneValue(sequencer_getEditedSequence(s, sequence_index), patternIndex, lane, stepIndex, value);
+	if (result > 0 && !_sequencer_isArmed(s, sequence_index)) {
+		_sequencer_notifyStep(s, sequence_index, patternIndex, stepIndex);
+	}
+	
+	return result;
 }
 
 int sequencer_setMutedPattern(step_sequencer_t * s, uint8_t patternIndex, bool value) {
@@ -295,7 +751,7 @@ int sequencer_setMutedPattern(step_sequencer_t * s, uint8_t patternIndex, bool v
 	s->muted_triggers[patternIndex] = value;
 	
 	if (s->muted_triggers_updated_cb != NULL) {
-		s->muted_triggers_updated_cb(s, patternIndex);
+		s->muted_triggers_updated_cb(s->ctx, patternIndex);
 	}
 	
 	return 1;
@@ -306,13 +762,103 @@ uint8_t sequencer_getCurrentSequenceIndex(step_sequencer_t * s) {
 }
 
 step_sequence_t * sequencer_getCurrentSequence(step_sequencer_t *s) {
-	return &s->sequences[sequencer_getCurrentSequenceIndex(s)];
+	return sequencer_getSequence(s, sequencer_getCurrentSequenceIndex(s));
+}
+
+step_sequence_t * sequencer_getSequence(step_sequencer_t * s, uint8_t sequenceIndex) {
+	return &s->banks[atomic_load_explicit(&s->live_banks[sequenceIndex], memory_order_acquire)][sequenceIndex];
+}
+
+step_sequence_t * sequencer_getEditedSequence(step_sequencer_t * s, uint8_t sequenceIndex) {
+	const uint8_t live = atomic_load_explicit(&s->live_banks[sequenceIndex], memory_order_acquire);
+	
+	return &s->banks[_sequencer_isArmed(s, sequenceIndex) ? live ^ 1 : live][sequenceIndex];
 }
 
 step_sequence_t * sequencer_getNextSequence(step_sequencer_t *s) {
 	if (s->next_sequence_index != NO_NEXT_SEQUENCE && s->next_sequence_index < N_SEQUENCES) {
-		return &s->sequences[(uint8_t)s->next_sequence_index];
+		return sequencer_getSequence(s, (uint8_t)s->next_sequence_index);
 	}
 	
 	return NULL;
 }
+
+step_sequence_t * sequencer_beginStaging(step_sequencer_t * s, uint8_t sequenceIndex, bool copyLive) {
+	unsigned char expected = kSequenceStaging_Idle;
+	
+	if (sequenceIndex >= N_SEQUENCES) {
+		return NULL;
+	}
+	if (!atomic_compare_exchange_strong_explicit(&s->staging_states[sequenceIndex], &expected, kSequenceStaging_Editing, memory_order_acquire, memory_order_relaxed)) {
+		return NULL;
+	}
+	
+	// the live copy is the clock's: copied whole on its thread only, edits applied meanwhile are not in the staged one
+	const uint8_t live = atomic_load_explicit(&s->live_banks[sequenceIndex], memory_order_acquire);
+	step_sequence_t * staging = &s->banks[live ^ 1][sequenceIndex];
+	if (copyLive) {
+		seq_copy(staging, &s->banks[live][sequenceIndex]);
+	}
+	
+	return staging;
+}
+
+int sequencer_commitStaging(step_sequencer_t * s, uint8_t sequenceIndex, SwapQuantize quantize) {
+	if (sequenceIndex >= N_SEQUENCES || atomic_load_explicit(&s->staging_states[sequenceIndex], memory_order_relaxed) != kSequenceStaging_Editing) {
+		return -1;
+	}
+	
+	s->staging_quantize[sequenceIndex] = quantize;
+	atomic_store_explicit(&s->staging_states[sequenceIndex], kSequenceStaging_Armed, memory_order_release);
+	
+	return 1;
+}
+
+step_sequence_t * sequencer_stageEdit(step_sequencer_t * s, uint8_t sequenceIndex, SwapQuantize quantize) {
+	if (sequenceIndex >= N_SEQUENCES) {
+		return NULL;
+	}
+	// armed already (a bank, a previous edit): joins it, at its boundary
+	if (_sequencer_isArmed(s, sequenceIndex)) {
+		return sequencer_getEditedSequence(s, sequenceIndex);
+	}
+	
+	step_sequence_t * staging = sequencer_beginStaging(s, sequenceIndex, true);
+	if (staging != NULL) {
+		sequencer_commitStaging(s, sequenceIndex, quantize);
+	}
+	
+	return staging;
+}
+
+void sequencer_cancelStaging(step_sequencer_t * s, uint8_t sequenceIndex) {
+	unsigned char expected = kSequenceStaging_Editing;
+	
+	if (sequenceIndex < N_SEQUENCES) {
+		atomic_compare_exchange_strong_explicit(&s->staging_states[sequenceIndex], &expected, kSequenceStaging_Idle, memory_order_relaxed, memory_order_relaxed);
+	}
+}
+
+int sequencer_stageBank(step_sequencer_t * s, const preset_bank_t * bank, SwapQuantize quantize) {
+	int staged = 0;
+	bool dropped = false;
+	
+	if (bank == NULL) {
+		return -1;
+	}
+	
+	// mutes first: the current sequence's swap applies them
+	atomic_store_explicit(&s->staged_mutes, bank->muted_triggers, memory_order_release);
+	
+	for (size_t i = 0; i < N_SEQUENCES; i++) {
+		step_sequence_t * staging = sequencer_beginStaging(s, i, false);
+		
+		if (staging != NULL) {
+			dropped |= preset_loadSequence(bank, i, staging) < 0;
+			sequencer_commitStaging(s, i, quantize);
+			staged++;
+		}
+	}
+	
+	return dropped ? -1 : staged;
+}
@@ -11,13 +11,23 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdatomic.h>
 #include "sequence.h"
 
+typedef struct trace_ring_t trace_ring_t;
+typedef struct preset_bank_t preset_bank_t;
+
 #define N_SEQUENCES                 16
 //TODO: remove from here
 #define N_TRIGGERS                  8
 #define NO_NEXT_SEQUENCE			-1
-#define DEFAULT_CLOCK_DIVIDER		3
+#define DEFAULT_CLOCK_DIVIDER		3												// sequencer_clock() calls per step
+#define SEQUENCER_CLOCK_PPQN		(4 * DEFAULT_CLOCK_DIVIDER)						// sequencer_clock() calls per quarter note, the tempo's DEFAULT_PPQN
+#define SEQUENCER_DEFAULT_PPQN		96												// timeline ticks per quarter note, the minimum too
+#define SEQUENCER_MAX_PPQN			960
+#define SEQUENCER_SWING_STRAIGHT	50												// % of a pair of steps the first one lasts
+#define SEQUENCER_SWING_MAX			75												// off-beat step half a step late
+#define SEQUENCER_RANDOM_SEED		0x2545F491
 
 typedef enum SequencerState {
 	kSequencerState_Stopped,
@@ -25,6 +35,19 @@ typedef enum SequencerState {
 	kSequencerState_Paused
 }SequencerState;
 
+typedef enum SwapQuantize {
+	kSwapQuantize_Step = 0,
+	kSwapQuantize_Beat,				// 4 steps
+	kSwapQuantize_Bar,				// 16 steps
+	kSwapQuantize_Sequence			// when it loops
+}SwapQuantize;
+
+typedef enum SequenceStaging {
+	kSequenceStaging_Idle = 0,		// staging copy unused
+	kSequenceStaging_Editing,		// owned by the thread which began it
+	kSequenceStaging_Armed			// owned by the clock until the swap
+}SequenceStaging;
+
 typedef enum Direction {
 	kDirection_Forward = 1,
 	kDirection_Backward = -1
@@ -33,12 +56,51 @@ typedef enum Direction {
 /*
 *       Step: A representation of a value at a given time
 *       Pattern: Group of pre-defined number of steps
+*
+*       Patterns and sequences hold no callback: every edit goes through a sequencer_* function
+*       which fires the observers below with the sequence/pattern indexes it was given
+*
+*       Each sequence has two copies: the live one, played and edited by the clock, and a staging
+*       one any other thread may rewrite at leisure (sequencer_beginStaging ... sequencer_commitStaging).
+*       At the quantized boundary sequencer_clock() flips live_banks[i]: nothing is copied but the
+*       playheads, the triggers held across the boundary are computed from the new copy as usual.
+*       The clock stages a multi-step edit of the playing sequence itself (sequencer_stageEdit):
+*       the live copy is only copied whole on its thread. Until the swap, the sequencer_* edits
+*       of an armed sequence go to its staged copy and fire no observer, the swap redraws
+*
+*       Time is a 64-bit timeline of ppqn ticks per quarter note which never wraps, each sequencer_clock()
+*       plays the next ppqn / SEQUENCER_CLOCK_PPQN of them. Playheads move on the step boundaries only;
+*       what a trigger does for a step (swing, offset, ratchets) is planned at its own tick, one step
+*       ahead for an early offset. event_tick tells a trigger observer where in the window the change
+*       falls: the host stamps it there rather than on the timer wakeup
 */
 
+typedef struct trigger_plan_t {
+	uint64_t					at;											// tick of the next hit
+	uint16_t					interval;									// ticks between two hits
+	uint8_t						hits;										// next one included
+	uint8_t						value;										// 0: release only
+	bool						release;									// before the next hit, not over a linked step
+} trigger_plan_t;
+
 typedef struct step_sequencer_t {
-	step_sequence_t				sequences[N_SEQUENCES];
-	volatile uint8_t            clock_cpt;
+	step_sequence_t				banks[2][N_SEQUENCES];						// live and staging copy of each sequence
+	lane_pool_t					lane_pool;									// lanes of both copies, edited patterns only
+	atomic_uchar				live_banks[N_SEQUENCES];					// banks[live_banks[i]][i] is played
+	atomic_uchar				staging_states[N_SEQUENCES];				// SequenceStaging
+	uint8_t						staging_quantize[N_SEQUENCES];				// SwapQuantize, set before kSequenceStaging_Armed
+	atomic_int					staged_mutes;								// bit n: trigger n, applied with the current sequence's swap, -1: none
 	volatile uint8_t            clock_divider;
+	
+	// timeline
+	uint64_t					tick;										// first tick of the next sequencer_clock()
+	uint64_t					step_tick;									// next step boundary
+	uint64_t					step_count;									// steps played since the last locate, odd ones swing
+	uint64_t					event_tick;									// of the trigger change being notified
+	uint32_t					step_cpt;									// position of the next step in the current sequence, its length at the loop point
+	uint16_t					ppqn;
+	uint8_t						swing;										// SEQUENCER_SWING_STRAIGHT-SEQUENCER_SWING_MAX %
+	uint8_t						trigger_swings[N_TRIGGERS];					// 0: swing
 	SequencerState              current_state;
 	Direction		            current_direction;
 	uint8_t						current_sequence_index;
@@ -46,16 +108,25 @@ typedef struct step_sequencer_t {
 	
 	uint8_t						triggers[N_TRIGGERS];
 	bool                        muted_triggers[N_TRIGGERS];
+	
+	// hits off the step boundary, by step parity: the next step is planned while the current one plays
+	trigger_plan_t				plans[2][N_TRIGGERS];
+	uint8_t						planned[2];									// bit n: trigger n
+	uint8_t						planned_early;								// bit n: trigger n's next step is planned already
+	uint32_t					random_state;								// probability lane, same seed: same render
+	trace_ring_t *				trace;										// step and swap records when set
 
-	void 						(*step_updated_cb)(void * seq, uint8_t sequence_index, uint8_t patternIndex, uint8_t stepIndex);
-	void 						(*pattern_updated_cb)(void * seq, uint8_t sequence_index, uint8_t patternIndex);
-	void 						(*muted_triggers_updated_cb)(void * seq, uint8_t pattern_index);
-	void 						(*direction_updated_cb)(void * seq);
-	void 						(*state_updated_cb)(void * seq);
-	void 						(*sequence_index_updated_cb)(void * sequencer, uint8_t sequence_index);
-	void						(*trigger_updated_cb)(void *seq, uint8_t triggerIndex);
-	void 						(*triggers_updated_cb)(void * seq);
-	void 						(*next_seq_index_updated_cb)(void * seq);
+	void 						(*step_updated_cb)(void * ctx, uint8_t sequence_index, uint8_t patternIndex, uint8_t stepIndex);
+	void 						(*playhead_updated_cb)(void * ctx, uint8_t sequence_index, uint8_t patternIndex, uint8_t prevStepIndex, uint8_t stepIndex);	// step_updated_cb twice when NULL
+	void 						(*pattern_updated_cb)(void * ctx, uint8_t sequence_index, uint8_t patternIndex);
+	void 						(*muted_triggers_updated_cb)(void * ctx, uint8_t pattern_index);
+	void 						(*direction_updated_cb)(void * ctx);
+	void 						(*state_updated_cb)(void * ctx);
+	void 						(*sequence_index_updated_cb)(void * ctx, uint8_t sequence_index);
+	void						(*trigger_updated_cb)(void * ctx, uint8_t triggerIndex);
+	void 						(*triggers_updated_cb)(void * ctx);
+	void 						(*next_seq_index_updated_cb)(void * ctx);
+	void *						ctx;										// given to every callback, the sequencer itself by default
 } step_sequencer_t;
 
 void 				sequencer_init(step_sequencer_t * s);
@@ -66,10 +137,39 @@ void 				sequencer_play(step_sequencer_t * s);
 void 				sequencer_pause(step_sequencer_t * s);
 uint8_t				sequencer_getCurrentSequenceIndex(step_sequencer_t * s);
 step_sequence_t *	sequencer_getCurrentSequence(step_sequencer_t *s);
+step_sequence_t *	sequencer_getSequence(step_sequencer_t * s, uint8_t sequenceIndex);				// live copy
+step_sequence_t *	sequencer_getEditedSequence(step_sequencer_t * s, uint8_t sequenceIndex);		// clock thread, the copy the edits below write
 int 				sequencer_setSequenceIndex(step_sequencer_t * s, uint8_t sequenceIndex);
 int					sequencer_setMutedPattern(step_sequencer_t * s, uint8_t patternIndex, bool value);
 int 				sequencer_setNextSequenceIndex(step_sequencer_t * s, int8_t sequenceIndex);
-int 				sequencer_load(step_sequencer_t * s);
+int 				sequencer_load(step_sequencer_t * s, const preset_bank_t * bank);				// every sequence and the mutes, playheads keep going, -1 lanes dropped
 void 				sequencer_resetCurrentStepIndexes(step_sequencer_t * s, uint8_t sequence_index);
+void 				sequencer_locate(step_sequencer_t * s, uint16_t step);							// next step fired will be step
+bool 				sequencer_isStepBoundary(step_sequencer_t * s);								// next sequencer_clock() moves the playhead (or not playing)
+
+// Timeline
+int 				sequencer_setPpqn(step_sequencer_t * s, uint16_t ppqn);						// multiple of SEQUENCER_CLOCK_PPQN, SEQUENCER_DEFAULT_PPQN-SEQUENCER_MAX_PPQN
+int 				sequencer_setSwing(step_sequencer_t * s, uint8_t swing);						// every trigger following it
+int 				sequencer_setTriggerSwing(step_sequencer_t * s, uint8_t triggerIndex, uint8_t swing);	// 0: the global swing
+uint16_t 			sequencer_ticksPerClock(const step_sequencer_t * s);
+uint32_t 			sequencer_stepTicks(const step_sequencer_t * s);
+uint64_t 			sequencer_eventOffset(const step_sequencer_t * s);							// ticks into the sequencer_clock() window, from a trigger observer
+
+// Staging, any thread but the clock: one writer per sequence at a time
+step_sequence_t *	sequencer_beginStaging(step_sequencer_t * s, uint8_t sequenceIndex, bool copyLive);	//NULL while a swap is pending or another writer has it, copyLive: clock thread only
+step_sequence_t *	sequencer_stageEdit(step_sequencer_t * s, uint8_t sequenceIndex, SwapQuantize quantize);	//clock thread: staged and armed, NULL while another writer has it
+int 				sequencer_commitStaging(step_sequencer_t * s, uint8_t sequenceIndex, SwapQuantize quantize);	//swapped by the clock at the boundary
+void 				sequencer_cancelStaging(step_sequencer_t * s, uint8_t sequenceIndex);
+int 				sequencer_stageBank(step_sequencer_t * s, const preset_bank_t * bank, SwapQuantize quantize);	//sequences staged, busy ones are skipped, -1 lanes dropped
+
+// Edits, observers are fired only when something changed (1 returned)
+void 				sequencer_clearPattern(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex);
+void 				sequencer_clearAllPatterns(step_sequencer_t * s, uint8_t sequence_index);
+int 				sequencer_setPatternStepValue(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex, uint8_t stepIndex, uint8_t value);
+int 				sequencer_togglePatternStepValue(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex, uint8_t stepIndex);
+int 				sequencer_setLastStepIndex(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex, uint8_t index);
+int 				sequencer_linkPatternSteps(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex, bool value);
+int 				sequencer_setPattern(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex, uint64_t gates, uint8_t lastStepIndex, bool linkSteps);	// whole pattern at once
+int 				sequencer_setLaneValue(step_sequencer_t * s, uint8_t sequence_index, uint8_t patternIndex, StepLane lane, uint8_t stepIndex, int value);	// step observers
 
 #endif /* sequencer_h */
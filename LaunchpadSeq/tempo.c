@@ -0,0 +1,326 @@
+//
+//  tempo.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#include "tempo.h"
+#include <string.h>
+#include <time.h>
+#if defined(__APPLE__)
+#include <mach/mach_time.h>
+#include <pthread/qos.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "noalloc.h"
+
+void _tempo_updatePeriod(tempo_clock_t * c) {
+	c->period_ns = (double)NSEC_PER_MINUTE / (c->bpm * c->ppqn);
+}
+
+// keeps the phase: the next deadline stays where it was, following ones use the new period
+void _tempo_applyPending(tempo_clock_t * c) {
+	// a plain load on every tick, an exchange only when something was set: a value set meanwhile is not lost
+	if (atomic_load_explicit(&c->pending_bpm, memory_order_relaxed) <= 0.0 && atomic_load_explicit(&c->pending_ppqn, memory_order_relaxed) == 0) {
+		return;
+	}
+	
+	const double bpm = atomic_exchange_explicit(&c->pending_bpm, 0.0, memory_order_acquire);
+	const uint16_t ppqn = atomic_exchange_explicit(&c->pending_ppqn, 0, memory_order_acquire);
+	
+	c->anchor_ns = tempo_nextDeadline(c);
+	c->tick_index = 0;
+	if (bpm > 0.0) {
+		c->bpm = bpm;
+	}
+	if (ppqn > 0) {
+		c->ppqn = ppqn;
+	}
+	_tempo_updatePeriod(c);
+}
+
+// ticks of the new timeline close to one already fired are skipped: never fire the same tick twice
+void _tempo_applyFollow(tempo_clock_t * c) {
+	const unsigned sequence = atomic_load_explicit(&c->follow_sequence, memory_order_acquire);
+	
+	// nothing new, or being written: the next call takes it
+	if (sequence == c->follow_applied || (sequence & 1)) {
+		return;
+	}
+	
+	const uint64_t anchor = atomic_load_explicit(&c->follow_anchor_ns, memory_order_relaxed);
+	const double period = atomic_load_explicit(&c->follow_period_ns, memory_order_relaxed);
+	atomic_thread_fence(memory_order_acquire);
+	if (atomic_load_explicit(&c->follow_sequence, memory_order_relaxed) != sequence) {
+		return;
+	}
+	c->follow_applied = sequence;
+	
+	c->period_ns = period;
+	c->bpm = (double)NSEC_PER_MINUTE / (period * c->ppqn);
+	c->anchor_ns = anchor;
+	c->tick_index = 0;
+	
+	if (c->last_tick_ns != 0) {
+		const double threshold = c->last_tick_ns + period / 2;
+		if ((double)anchor < threshold) {
+			c->tick_index = (uint64_t)((threshold - anchor) / period) + 1;
+		}
+	}
+}
+
+void _tempo_recordJitter(tempo_clock_t * c, int64_t jitter) {
+	tempo_stats_t * st = &c->stats;
+	
+	if (st->wakeups == 0 || jitter < st->jitter_min_ns) {
+		st->jitter_min_ns = jitter;
+	}
+	if (st->wakeups == 0 || jitter > st->jitter_max_ns) {
+		st->jitter_max_ns = jitter;
+	}
+	st->jitter_abs_sum_ns += jitter < 0 ? -jitter : jitter;
+	st->wakeups++;
+}
+
+//-----------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------
+
+void tempo_init(tempo_clock_t * c) {
+	c->bpm = DEFAULT_BPM;
+	c->ppqn = DEFAULT_PPQN;
+	atomic_init(&c->pending_bpm, 0.0);
+	atomic_init(&c->pending_ppqn, 0);
+	c->catch_up = kTempoCatchUp_Burst;
+	c->max_catch_up = DEFAULT_MAX_CATCH_UP;
+	c->running = false;
+	c->anchor_ns = 0;
+	c->tick_index = 0;
+	c->last_tick_ns = 0;
+	c->holding = false;
+	atomic_init(&c->follow_sequence, 0);
+	atomic_init(&c->follow_anchor_ns, 0);
+	atomic_init(&c->follow_period_ns, 0.0);
+	c->follow_applied = 0;
+	_tempo_updatePeriod(c);
+	tempo_resetStats(c);
+}
+
+void tempo_setBpm(tempo_clock_t * c, double bpm) {
+	if (bpm <= 0.0) {
+		return;
+	}
+	
+	if (c->running) {
+		atomic_store_explicit(&c->pending_bpm, bpm, memory_order_release);
+	} else {
+		c->bpm = bpm;
+		_tempo_updatePeriod(c);
+	}
+}
+
+void tempo_setPpqn(tempo_clock_t * c, uint16_t ppqn) {
+	if (ppqn == 0) {
+		return;
+	}
+	
+	if (c->running) {
+		atomic_store_explicit(&c->pending_ppqn, ppqn, memory_order_release);
+	} else {
+		c->ppqn = ppqn;
+		_tempo_updatePeriod(c);
+	}
+}
+
+void tempo_reset(tempo_clock_t * c, uint64_t now_ns) {
+	c->anchor_ns = now_ns;
+	c->tick_index = 0;
+}
+
+uint64_t tempo_nextDeadline(tempo_clock_t * c) {
+	return c->anchor_ns + (uint64_t)(c->tick_index * c->period_ns);
+}
+
+uint64_t tempo_process(tempo_clock_t * c, uint64_t now_ns) {
+	_tempo_applyFollow(c);
+	
+	uint64_t deadline = tempo_nextDeadline(c);
+	uint8_t fired = 0;
+	
+	if (c->holding) {
+		// poll until an external source starts us again
+		if (c->idle_cb != NULL) {
+			c->idle_cb(c->ctx);
+		}
+		return now_ns + TEMPO_HOLD_POLL_NS;
+	}
+	
+	if (now_ns < deadline) {
+		return deadline;
+	}
+	
+	_tempo_recordJitter(c, (int64_t)(now_ns - deadline));
+	
+	while (deadline <= now_ns) {
+		const uint8_t maxFired = c->catch_up == kTempoCatchUp_Skip ? 1 : c->max_catch_up;
+		
+		if (fired < maxFired) {
+			// tick_cb can read the ideal time of the tick it handles
+			c->last_tick_ns = deadline;
+			if (c->tick_cb != NULL) {
+				c->tick_cb(c->ctx);
+			}
+			fired++;
+		} else {
+			c->stats.missed_ticks++;
+		}
+		
+		c->tick_index++;
+		_tempo_applyPending(c);
+		deadline = tempo_nextDeadline(c);
+	}
+	
+	return deadline;
+}
+
+void tempo_resetStats(tempo_clock_t * c) {
+	memset(&c->stats, 0x00, sizeof(c->stats));
+}
+
+void tempo_follow(tempo_clock_t * c, uint64_t tick_ns, double period_ns) {
+	if (period_ns <= 0.0) {
+		return;
+	}
+	
+	const unsigned sequence = atomic_load_explicit(&c->follow_sequence, memory_order_relaxed);
+	
+	// odd while the timeline is written: the clock never applies half of one
+	atomic_store_explicit(&c->follow_sequence, sequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&c->follow_anchor_ns, tick_ns, memory_order_relaxed);
+	atomic_store_explicit(&c->follow_period_ns, period_ns, memory_order_relaxed);
+	atomic_store_explicit(&c->follow_sequence, sequence + 2, memory_order_release);
+}
+
+void tempo_hold(tempo_clock_t * c, bool hold) {
+	c->holding = hold;
+}
+
+// --- HOST ---
+
+#if defined(__APPLE__) || defined(__linux__)
+
+#if defined(__APPLE__)
+// same time base as CoreMIDI timestamps
+mach_timebase_info_data_t _tempo_timebase(void) {
+	mach_timebase_info_data_t tb;
+	mach_timebase_info(&tb);
+	return tb;
+}
+#endif
+
+uint64_t tempo_now(void) {
+#if defined(__APPLE__)
+	return tempo_hostTimeToNs(mach_absolute_time());
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+uint64_t tempo_hostTimeToNs(uint64_t hostTime) {
+#if defined(__APPLE__)
+	const mach_timebase_info_data_t tb = _tempo_timebase();
+	return hostTime * tb.numer / tb.denom;
+#else
+	return hostTime;
+#endif
+}
+
+uint64_t tempo_nsToHostTime(uint64_t ns) {
+#if defined(__APPLE__)
+	const mach_timebase_info_data_t tb = _tempo_timebase();
+	return ns * tb.denom / tb.numer;
+#else
+	return ns;
+#endif
+}
+
+void tempo_sleepUntil(uint64_t deadline_ns) {
+#if defined(__APPLE__)
+	const mach_timebase_info_data_t tb = _tempo_timebase();
+	mach_wait_until(deadline_ns * tb.denom / tb.numer);
+#else
+	struct timespec ts;
+	ts.tv_sec = deadline_ns / 1000000000ULL;
+	ts.tv_nsec = deadline_ns % 1000000000ULL;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+		// interrupted, sleep again until the same absolute deadline
+	}
+#endif
+}
+
+void * _tempo_thread(void * arg) {
+	tempo_clock_t * c = (tempo_clock_t *)arg;
+	
+	tempo_reset(c, tempo_now());
+	while (c->running) {
+		const uint64_t deadline = tempo_process(c, tempo_now());
+		tempo_sleepUntil(deadline);
+	}
+	
+	return NULL;
+}
+
+int tempo_createThread(pthread_t * thread, void * (*fn)(void *), void * arg, int priorityBelowMax) {
+	pthread_attr_t attr;
+	int result = 0;
+	
+	pthread_attr_init(&attr);
+#if defined(__APPLE__)
+	pthread_attr_set_qos_class_np(&attr, QOS_CLASS_USER_INTERACTIVE, 0);
+#elif defined(__linux__)
+	// SCHED_FIFO needs CAP_SYS_NICE / rtprio, fall back to a normal thread otherwise
+	struct sched_param param = {0};
+	param.sched_priority = sched_get_priority_max(SCHED_FIFO) - priorityBelowMax;
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	pthread_attr_setschedparam(&attr, &param);
+	if (pthread_create(thread, &attr, fn, arg) == 0) {
+		pthread_attr_destroy(&attr);
+		return 1;
+	}
+	pthread_attr_destroy(&attr);
+	pthread_attr_init(&attr);
+#endif
+	result = pthread_create(thread, &attr, fn, arg) == 0 ? 1 : -1;
+	pthread_attr_destroy(&attr);
+	
+	return result;
+}
+
+int tempo_start(tempo_clock_t * c) {
+	if (c->running) {
+		return 0;
+	}
+	
+	c->running = true;
+	if (tempo_createThread(&c->thread, _tempo_thread, c, TEMPO_THREAD_PRIORITY) < 0) {
+		c->running = false;
+		return -1;
+	}
+	
+	return 1;
+}
+
+void tempo_stop(tempo_clock_t * c) {
+	if (c->running) {
+		c->running = false;
+		pthread_join(c->thread, NULL);
+	}
+}
+
+#endif
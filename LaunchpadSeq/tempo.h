@@ -0,0 +1,95 @@
+//
+//  tempo.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#ifndef tempo_h
+#define tempo_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#if defined(__APPLE__) || defined(__linux__)
+#include <pthread.h>
+#endif
+
+#define DEFAULT_BPM					250.0
+#define DEFAULT_PPQN				12											// 3 clock ticks per step, 4 steps per beat
+#define DEFAULT_MAX_CATCH_UP		4
+#define NSEC_PER_MINUTE				60000000000ULL
+#define TEMPO_THREAD_PRIORITY		1												// below max SCHED_FIFO priority
+#define TEMPO_HOLD_POLL_NS			1000000ULL										// wakeup rate while holding
+
+typedef enum TempoCatchUp {
+	kTempoCatchUp_Burst = 0,		// fire missed ticks back to back (up to max_catch_up), drop the others
+	kTempoCatchUp_Skip = 1			// fire one tick, drop every other missed one
+} TempoCatchUp;
+
+typedef struct tempo_stats_t {
+	uint64_t					wakeups;
+	uint64_t					missed_ticks;									// dropped by the catch up rule
+	int64_t						jitter_min_ns;									// wakeup - deadline
+	int64_t						jitter_max_ns;
+	uint64_t					jitter_abs_sum_ns;								// mean = sum / wakeups
+} tempo_stats_t;
+
+/*
+*       Every deadline is computed from anchor_ns, so a late wakeup never shifts the next ones.
+*       Another thread hands changes over without a lock: a pending bpm or ppqn is taken with an
+*       exchange, the follow timeline (one writer) is framed by a sequence number like a trace slot
+*/
+
+typedef struct tempo_clock_t {
+	double						bpm;
+	uint16_t					ppqn;
+	_Atomic double				pending_bpm;									// applied on the next tick (0: none)
+	atomic_ushort				pending_ppqn;
+	double						period_ns;
+	uint64_t					anchor_ns;										// deadline of tick 0
+	uint64_t					tick_index;										// next tick to fire, from anchor_ns
+	uint64_t					last_tick_ns;									// deadline of the last fired tick
+	volatile bool				holding;										// no tick fired while true (waiting for an external start)
+	
+	// timeline pushed by an external source (see tempo_follow), applied before the next tick
+	atomic_uint					follow_sequence;								// odd while written, += 2 per timeline
+	atomic_ullong				follow_anchor_ns;
+	_Atomic double				follow_period_ns;
+	unsigned					follow_applied;									// clock thread, last follow_sequence applied
+	TempoCatchUp				catch_up;
+	uint8_t						max_catch_up;
+	tempo_stats_t				stats;
+	volatile bool				running;
+#if defined(__APPLE__) || defined(__linux__)
+	pthread_t					thread;
+#endif
+
+	void						(*tick_cb)(void * ctx);
+	void						(*idle_cb)(void * ctx);							// clock thread, every hold poll
+	void *						ctx;
+} tempo_clock_t;
+
+void 				tempo_init(tempo_clock_t * c);
+void 				tempo_setBpm(tempo_clock_t * c, double bpm);
+void 				tempo_setPpqn(tempo_clock_t * c, uint16_t ppqn);
+void 				tempo_reset(tempo_clock_t * c, uint64_t now_ns);
+uint64_t 			tempo_nextDeadline(tempo_clock_t * c);
+uint64_t 			tempo_process(tempo_clock_t * c, uint64_t now_ns);			//fires due ticks, returns next deadline
+void 				tempo_resetStats(tempo_clock_t * c);
+void 				tempo_follow(tempo_clock_t * c, uint64_t tick_ns, double period_ns);	//ticks at tick_ns + k * period_ns from now on, one thread
+void 				tempo_hold(tempo_clock_t * c, bool hold);
+
+// Host only: monotonic time and a dedicated (real-time when allowed) thread
+uint64_t 			tempo_now(void);
+uint64_t 			tempo_hostTimeToNs(uint64_t hostTime);						//MIDI packet timestamps to tempo_now() time
+uint64_t 			tempo_nsToHostTime(uint64_t ns);
+void 				tempo_sleepUntil(uint64_t deadline_ns);
+#if defined(__APPLE__) || defined(__linux__)
+int 				tempo_createThread(pthread_t * thread, void * (*fn)(void *), void * arg, int priorityBelowMax);	//real-time when allowed
+#endif
+int 				tempo_start(tempo_clock_t * c);
+void 				tempo_stop(tempo_clock_t * c);
+
+#endif /* tempo_h */
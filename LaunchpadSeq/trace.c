@@ -0,0 +1,215 @@
+//
+//  trace.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#include "trace.h"
+#include <string.h>
+#include "tempo.h"
+
+#include "noalloc.h"
+
+const char * _trace_names[kTraceEvent_Count] = {
+	"none",
+	"clock",
+	"step",
+	"swap",
+	"flush",
+	"input",
+	"staging"
+};
+
+uint64_t _trace_pack(TraceEventId id, uint8_t a, uint8_t b, uint8_t c, uint32_t value) {
+	return (uint64_t)id << 56 | (uint64_t)a << 48 | (uint64_t)b << 40 | (uint64_t)c << 32 | value;
+}
+
+void _trace_unpack(uint64_t payload, trace_record_t * record) {
+	record->id = (uint8_t)(payload >> 56);
+	record->a = (uint8_t)(payload >> 48);
+	record->b = (uint8_t)(payload >> 40);
+	record->c = (uint8_t)(payload >> 32);
+	record->value = (uint32_t)payload;
+}
+
+// lapped: the oldest records are gone, reading resumes one ring behind the writers
+void _trace_resync(trace_ring_t * t) {
+	const unsigned head = atomic_load_explicit(&t->head, memory_order_acquire);
+	
+	if (head - t->tail > TRACE_RING_SIZE) {
+		t->lost += head - t->tail - TRACE_RING_SIZE;
+		t->tail = head - TRACE_RING_SIZE;
+	}
+}
+
+void _trace_print(void * ctx, const trace_record_t * record) {
+	char line[96];
+	
+	if (trace_format(record, line, sizeof(line)) > 0) {
+		fputs(line, (FILE *)ctx);
+	}
+}
+
+//-----------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------
+
+void trace_init(trace_ring_t * t) {
+	for (size_t i = 0; i < TRACE_RING_SIZE; i++) {
+		atomic_init(&t->slots[i].sequence, 0);
+		atomic_init(&t->slots[i].time_ns, 0);
+		atomic_init(&t->slots[i].payload, 0);
+	}
+	atomic_init(&t->head, 0);
+	atomic_init(&t->enabled, true);
+	t->tail = 0;
+	t->lost = 0;
+	t->stalled = 0;
+	t->stalled_since_ns = 0;
+	t->out = stdout;
+	t->period_ns = TRACE_DRAIN_PERIOD_NS;
+	t->running = false;
+}
+
+void trace_write(trace_ring_t * t, TraceEventId id, uint8_t a, uint8_t b, uint8_t c, uint32_t value) {
+	if (t == NULL || !atomic_load_explicit(&t->enabled, memory_order_relaxed)) {
+		return;
+	}
+	
+	const unsigned index = atomic_fetch_add_explicit(&t->head, 1, memory_order_relaxed);
+	trace_slot_t * slot = &t->slots[index & (TRACE_RING_SIZE - 1)];
+	
+	atomic_store_explicit(&slot->sequence, 2 * index + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&slot->time_ns, tempo_now(), memory_order_relaxed);
+	atomic_store_explicit(&slot->payload, _trace_pack(id, a, b, c, value), memory_order_relaxed);
+	atomic_store_explicit(&slot->sequence, 2 * index + 2, memory_order_release);
+}
+
+uint32_t trace_drain(trace_ring_t * t, trace_record_cb cb, void * ctx) {
+	uint32_t count = 0;
+	
+	_trace_resync(t);
+	
+	// a resync may take the tail past this head
+	const unsigned head = atomic_load_explicit(&t->head, memory_order_acquire);
+	while ((int)(head - t->tail) > 0) {
+		trace_slot_t * slot = &t->slots[t->tail & (TRACE_RING_SIZE - 1)];
+		const unsigned expected = 2 * t->tail + 2;
+		const unsigned before = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		
+		if ((int)(before - expected) < 0) {
+			// claimed, still being written: next drain, resynced by then if the writers lapped it.
+			// A slower writer of the previous lap may have put its older record back over this one
+			const uint64_t now = tempo_now();
+			
+			if (t->stalled != t->tail || t->stalled_since_ns == 0) {
+				t->stalled = t->tail;
+				t->stalled_since_ns = now;
+				break;
+			}
+			if (now - t->stalled_since_ns < t->period_ns) {
+				break;
+			}
+			t->stalled_since_ns = 0;
+			t->tail++;
+			t->lost++;
+			continue;
+		}
+		
+		trace_record_t record;
+		record.time_ns = atomic_load_explicit(&slot->time_ns, memory_order_relaxed);
+		const uint64_t payload = atomic_load_explicit(&slot->payload, memory_order_relaxed);
+		atomic_thread_fence(memory_order_acquire);
+		const unsigned after = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+		
+		t->tail++;
+		
+		if (before != expected || after != expected) {
+			// overwritten while read: the writers are a ring ahead, not worth reading slot by slot
+			t->lost++;
+			_trace_resync(t);
+			continue;
+		}
+		
+		_trace_unpack(payload, &record);
+		if (cb != NULL) {
+			cb(ctx, &record);
+		}
+		count++;
+	}
+	
+	return count;
+}
+
+int trace_format(const trace_record_t * record, char * buffer, size_t size) {
+	const char * name = record->id < kTraceEvent_Count ? _trace_names[record->id] : "?";
+	const unsigned long long us = (unsigned long long)(record->time_ns / 1000);
+	
+	switch ((TraceEventId)record->id) {
+		case kTraceEvent_Clock:
+			return snprintf(buffer, size, "%llu %s: cpt %u late %u ns\n", us, name, record->a, record->value);
+		case kTraceEvent_Step:
+			return snprintf(buffer, size, "%llu %s: seq %u step %u\n", us, name, record->a, record->b);
+		case kTraceEvent_SequenceSwap:
+			return snprintf(buffer, size, "%llu %s: %u -> %u\n", us, name, record->a, record->b);
+		case kTraceEvent_Flush:
+			return snprintf(buffer, size, "%llu %s: %u LEDs\n", us, name, record->value);
+		case kTraceEvent_Input:
+			return snprintf(buffer, size, "%llu %s: %02X %02X %02X\n", us, name, record->a, record->b, record->c);
+		case kTraceEvent_Staging:
+			return snprintf(buffer, size, "%llu %s: seq %u live %u\n", us, name, record->a, record->b);
+		default:
+			return snprintf(buffer, size, "%llu %s: %u %u %u %u\n", us, name, record->a, record->b, record->c, record->value);
+	}
+}
+
+uint32_t trace_dump(trace_ring_t * t, FILE * out) {
+	const uint32_t lost = t->lost;
+	const uint32_t count = trace_drain(t, _trace_print, out);
+	
+	if (t->lost != lost) {
+		fprintf(out, "trace: %u records lost\n", t->lost - lost);
+	}
+	fflush(out);
+	
+	return count;
+}
+
+#if defined(__APPLE__) || defined(__linux__)
+
+void * _trace_thread(void * arg) {
+	trace_ring_t * t = (trace_ring_t *)arg;
+	
+	while (t->running) {
+		trace_dump(t, t->out);
+		tempo_sleepUntil(tempo_now() + t->period_ns);
+	}
+	trace_dump(t, t->out);
+	
+	return NULL;
+}
+
+int trace_start(trace_ring_t * t) {
+	if (t->running) {
+		return 0;
+	}
+	
+	// stdio may block on a slow terminal: only this thread ever waits for it
+	t->running = true;
+	if (pthread_create(&t->thread, NULL, _trace_thread, t) != 0) {
+		t->running = false;
+		return -1;
+	}
+	
+	return 1;
+}
+
+void trace_stop(trace_ring_t * t) {
+	if (t->running) {
+		t->running = false;
+		pthread_join(t->thread, NULL);
+	}
+}
+
+#endif
@@ -0,0 +1,83 @@
+//
+//  trace.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#ifndef trace_h
+#define trace_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#if defined(__APPLE__) || defined(__linux__)
+#include <pthread.h>
+#endif
+
+#define TRACE_RING_SIZE				1024											// power of 2, records kept when nobody drains
+#define TRACE_DRAIN_PERIOD_NS		100000000ULL									// 100 ms
+
+typedef enum TraceEventId {
+	kTraceEvent_None = 0,
+	kTraceEvent_Clock,				// a: tempo tick index (low byte), value: tick lateness (ns)
+	kTraceEvent_Step,				// a: sequence, b: step
+	kTraceEvent_SequenceSwap,		// a: from, b: to
+	kTraceEvent_Flush,				// value: LED messages sent
+	kTraceEvent_Input,				// a, b, c: MIDI bytes
+	kTraceEvent_Staging,			// a: sequence, b: live copy now
+	kTraceEvent_Count
+} TraceEventId;
+
+typedef struct trace_record_t {
+	uint64_t					time_ns;										// tempo_now() time
+	uint8_t						id;
+	uint8_t						a;
+	uint8_t						b;
+	uint8_t						c;
+	uint32_t					value;
+} trace_record_t;
+
+/*
+*       Flight recorder: writers (clock, MIDI, render threads) claim a slot with one atomic add
+*       and never wait, the oldest records are overwritten when nobody drains. Each slot has a
+*       sequence number written before and after the record, the reader drops the ones it
+*       catches half written or already overwritten. A record still not written a drain period
+*       after the reader first waited on it is given up: a lapping writer left it stale for good.
+*/
+
+typedef struct trace_slot_t {
+	atomic_uint					sequence;										// 2 * index + 1 while written, 2 * index + 2 once done
+	atomic_ullong				time_ns;
+	atomic_ullong				payload;										// id | a | b | c | value
+} trace_slot_t;
+
+typedef struct trace_ring_t {
+	trace_slot_t				slots[TRACE_RING_SIZE];
+	atomic_uint					head;											// next index to claim, any thread
+	uint32_t					tail;											// next index to read, reader only
+	uint32_t					lost;											// overwritten before being read
+	uint32_t					stalled;										// index the reader waits on, reader only
+	uint64_t					stalled_since_ns;
+	atomic_bool					enabled;
+	
+	FILE *						out;											// drain thread output
+	uint64_t					period_ns;
+	volatile bool				running;
+#if defined(__APPLE__) || defined(__linux__)
+	pthread_t					thread;
+#endif
+} trace_ring_t;
+
+typedef void (*trace_record_cb)(void * ctx, const trace_record_t * record);
+
+void 				trace_init(trace_ring_t * t);
+void 				trace_write(trace_ring_t * t, TraceEventId id, uint8_t a, uint8_t b, uint8_t c, uint32_t value);	//wait-free, t may be NULL
+uint32_t 			trace_drain(trace_ring_t * t, trace_record_cb cb, void * ctx);				//one reader at a time, returns records read
+int 				trace_format(const trace_record_t * record, char * buffer, size_t size);
+uint32_t 			trace_dump(trace_ring_t * t, FILE * out);									//drains as text, on demand
+int 				trace_start(trace_ring_t * t);												//drains to t->out every period
+void 				trace_stop(trace_ring_t * t);
+
+#endif /* trace_h */
@@ -0,0 +1,300 @@
+//
+//  transport.c
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#include "transport.h"
+#include <string.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include "tempo.h"
+#endif
+
+#include "noalloc.h"
+
+uint8_t _transport_dataLength(uint8_t status) {
+	switch (status & 0xF0) {
+		case kSLMIDIMessageType_ProgramChange:
+		case kSLMIDIMessageType_AftertouchChannel:
+			return 1;
+		case kSLMIDIMessageType_System:
+			switch (status) {
+				case 0xF1:
+				case 0xF3:
+					return 1;
+				case kSLMIDIMessageType_SystemSongPosition:
+					return 2;
+				default:
+					return 0;
+			}
+		default:
+			return 2;
+	}
+}
+
+void _transport_deliver(midi_transport_t * t, SLMIDIPacket * pkt, uint64_t time_ns) {
+	pkt->timestamp = time_ns;
+	if (t->receive_cb != NULL) {
+		t->receive_cb(t->ctx, pkt);
+	}
+}
+
+//-----------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------
+
+void transport_init(midi_transport_t * t) {
+	memset(t, 0x00, sizeof(*t));
+	t->kind = kTransport_Closed;
+	t->fd = -1;
+}
+
+void transport_parse(midi_transport_t * t, const uint8_t * data, size_t length, uint64_t time_ns) {
+	for (size_t i = 0; i < length; i++) {
+		const uint8_t byte = data[i];
+		
+		if (byte >= kSLMIDIMessageType_SystemClockTick) {
+			// real-time: never breaks the message around it
+			t->realtime.length = 1;
+			t->realtime.data[0] = byte;
+			_transport_deliver(t, &t->realtime, time_ns);
+			continue;
+		}
+		
+		if (t->in_sysex) {
+			if (byte & 0x80 && byte != kSLMIDIMessageType_SystemExclusiveEnd) {
+				// unterminated SysEx, this status starts a new message
+				t->in_sysex = false;
+				t->dropped_bytes += t->pkt.length;
+				t->pkt.length = 0;
+			} else {
+				if (t->pkt.length < SL_MIDI_PACKET_MAX_LENGTH) {
+					t->pkt.data[t->pkt.length++] = byte;
+				} else {
+					t->dropped_bytes++;
+				}
+				if (byte == kSLMIDIMessageType_SystemExclusiveEnd) {
+					t->in_sysex = false;
+					// F7 not stored: too long, not delivered truncated
+					if (t->pkt.data[t->pkt.length - 1] == kSLMIDIMessageType_SystemExclusiveEnd) {
+						_transport_deliver(t, &t->pkt, time_ns);
+					}
+					t->pkt.length = 0;
+				}
+				continue;
+			}
+		}
+		
+		if (byte == kSLMIDIMessageType_SystemExclusiveEnd) {
+			// stray F7, no SysEx to end
+			t->dropped_bytes++;
+			continue;
+		}
+		
+		if (byte & 0x80) {
+			t->pkt.length = 1;
+			t->pkt.data[0] = byte;
+			
+			if (byte == kSLMIDIMessageType_System) {
+				t->in_sysex = true;
+				t->running_status = 0;
+				continue;
+			}
+			
+			// system common cancels running status
+			t->running_status = byte < kSLMIDIMessageType_System ? byte : 0;
+			t->expected = _transport_dataLength(byte);
+		} else {
+			if (t->pkt.length == 0) {
+				if (t->running_status == 0) {
+					t->dropped_bytes++;
+					continue;
+				}
+				// running status
+				t->pkt.length = 1;
+				t->pkt.data[0] = t->running_status;
+				t->expected = _transport_dataLength(t->running_status);
+			}
+			t->pkt.data[t->pkt.length++] = byte;
+		}
+		
+		if (t->pkt.length == t->expected + 1) {
+			_transport_deliver(t, &t->pkt, time_ns);
+			t->pkt.length = 0;
+		}
+	}
+}
+
+#if defined(__linux__)
+
+int _transport_setNonBlocking(int fd) {
+	const int flags = fcntl(fd, F_GETFL, 0);
+	
+	return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// as much as the driver takes without waiting, -1: fd error
+ssize_t _transport_write(midi_transport_t * t, const uint8_t * data, size_t length) {
+	size_t sent = 0;
+	
+	while (sent < length) {
+		const ssize_t n = write(t->fd, data + sent, length - sent);
+		
+		if (n > 0) {
+			sent += n;
+		} else if (n < 0 && errno == EINTR) {
+			continue;
+		} else if (n < 0 && errno == EAGAIN) {
+			break;
+		} else {
+			return -1;
+		}
+	}
+	
+	return sent;
+}
+
+// whole or not at all: a message cut short would garble the next one
+int _transport_queue(midi_transport_t * t, const uint8_t * data, size_t length) {
+	if (length > TRANSPORT_OUT_SIZE - t->out_length) {
+		t->dropped_writes++;
+		return -1;
+	}
+	if (t->out_start + t->out_length + length > TRANSPORT_OUT_SIZE) {
+		memmove(t->out, t->out + t->out_start, t->out_length);
+		t->out_start = 0;
+	}
+	memcpy(t->out + t->out_start + t->out_length, data, length);
+	t->out_length += length;
+	
+	return 0;
+}
+
+int transport_openRawMidi(midi_transport_t * t, const char * device) {
+	char path[64];
+	int card, dev;
+	
+	transport_init(t);
+	
+	// "hw:1,0" -> /dev/snd/midiC1D0
+	if (sscanf(device, "hw:%d,%d", &card, &dev) == 2) {
+		snprintf(path, sizeof(path), "/dev/snd/midiC%dD%d", card, dev);
+		device = path;
+	}
+	
+	t->fd = open(device, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (t->fd < 0) {
+		return -1;
+	}
+	t->kind = kTransport_RawMidi;
+	
+	return 1;
+}
+
+int transport_openLoopback(midi_transport_t * a, midi_transport_t * b) {
+	int fds[2];
+	
+	transport_init(a);
+	transport_init(b);
+	
+	// a stream like the device file, both ends in this process
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+		return -1;
+	}
+	if (_transport_setNonBlocking(fds[0]) < 0 || _transport_setNonBlocking(fds[1]) < 0) {
+		close(fds[0]);
+		close(fds[1]);
+		return -1;
+	}
+	
+	a->fd = fds[0];
+	a->kind = kTransport_Loopback;
+	b->fd = fds[1];
+	b->kind = kTransport_Loopback;
+	
+	return 1;
+}
+
+int transport_send(midi_transport_t * t, const uint8_t * data, size_t length) {
+	if (t->fd < 0) {
+		return -1;
+	}
+	
+	// behind what is still queued, never before it
+	if (t->out_length > 0) {
+		const int flushed = transport_flush(t);
+		
+		if (flushed <= 0) {
+			return flushed < 0 ? -1 : _transport_queue(t, data, length);
+		}
+	}
+	
+	const ssize_t sent = _transport_write(t, data, length);
+	
+	if (sent < 0) {
+		t->dropped_writes++;
+		return -1;
+	}
+	if ((size_t)sent == length) {
+		return 1;
+	}
+	// driver buffer full: the rest goes out once the fd is writable again
+	return _transport_queue(t, data + sent, length - sent);
+}
+
+int transport_flush(midi_transport_t * t) {
+	if (t->fd < 0) {
+		return -1;
+	}
+	
+	const ssize_t sent = _transport_write(t, t->out + t->out_start, t->out_length);
+	
+	if (sent < 0) {
+		t->dropped_writes++;
+		t->out_length = 0;
+		return -1;
+	}
+	t->out_start += sent;
+	t->out_length -= sent;
+	if (t->out_length == 0) {
+		t->out_start = 0;
+	}
+	
+	return t->out_length == 0;
+}
+
+int transport_read(midi_transport_t * t) {
+	uint8_t buffer[TRANSPORT_READ_CHUNK];
+	
+	for (;;) {
+		const ssize_t n = read(t->fd, buffer, sizeof(buffer));
+		
+		if (n > 0) {
+			transport_parse(t, buffer, n, tempo_now());
+		} else if (n == 0) {
+			// other end gone (unplugged, loopback closed)
+			return -1;
+		} else if (errno == EINTR) {
+			continue;
+		} else {
+			return errno == EAGAIN ? 1 : -1;
+		}
+	}
+}
+
+void transport_close(midi_transport_t * t) {
+	if (t->fd >= 0) {
+		close(t->fd);
+	}
+	t->fd = -1;
+	t->kind = kTransport_Closed;
+	t->out_start = 0;
+	t->out_length = 0;
+}
+
+#endif
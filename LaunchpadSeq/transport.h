@@ -0,0 +1,66 @@
+//
+//  transport.h
+//  LaunchpadSeq
+//
+//  Created by Guillaume Gekière on 17/10/2026.
+//
+
+#ifndef transport_h
+#define transport_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "midi.h"
+
+#define TRANSPORT_READ_CHUNK		256
+#define TRANSPORT_OUT_SIZE			2048											// bytes the driver did not take yet, a few flushes
+
+typedef enum TransportKind {
+	kTransport_Closed = 0,
+	kTransport_RawMidi,				// ALSA kernel rawmidi device, /dev/snd/midiC<card>D<device>
+	kTransport_Loopback				// in-process pair, what one end sends the other receives
+} TransportKind;
+
+/*
+*       A raw MIDI byte stream split back into messages: one receive_cb per message
+*       (running status expanded, real-time bytes delivered on their own, SysEx whole)
+*/
+
+typedef struct midi_transport_t {
+	TransportKind				kind;
+	int							fd;
+	
+	// parser
+	SLMIDIPacket				pkt;											// message being assembled
+	SLMIDIPacket				realtime;										// 0xF8-0xFF, may come inside pkt
+	uint8_t						running_status;
+	uint8_t						expected;										// data bytes of pkt
+	bool						in_sysex;
+	uint32_t					dropped_bytes;									// data without status, SysEx too long
+	uint32_t					dropped_writes;
+	
+	// writer: what the driver did not take yet, sent before anything newer
+	uint8_t						out[TRANSPORT_OUT_SIZE];
+	uint16_t					out_start;
+	uint16_t					out_length;
+	
+	void						(*receive_cb)(void * ctx, SLMIDIPacket * pkt);	// pkt->timestamp: tempo_now() time
+	void *						ctx;
+} midi_transport_t;
+
+_Static_assert(TRANSPORT_OUT_SIZE >= SL_MIDI_PACKET_MAX_LENGTH, "a whole packet is queued when nothing else is");
+
+void 				transport_init(midi_transport_t * t);
+void 				transport_parse(midi_transport_t * t, const uint8_t * data, size_t length, uint64_t time_ns);
+
+#if defined(__linux__)
+int 				transport_openRawMidi(midi_transport_t * t, const char * device);			//path or hw:<card>,<device>
+int 				transport_openLoopback(midi_transport_t * a, midi_transport_t * b);
+int 				transport_send(midi_transport_t * t, const uint8_t * data, size_t length);	//never waits, 0: rest queued until transport_flush
+int 				transport_flush(midi_transport_t * t);										//when the fd is writable, 1: nothing left queued
+int 				transport_read(midi_transport_t * t);										//drains the fd, -1 when closed
+void 				transport_close(midi_transport_t * t);
+#endif
+
+#endif /* transport_h */
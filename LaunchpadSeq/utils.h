@@ -14,4 +14,18 @@ static inline size_t utils_circularLoopGetIndex(size_t currentIndex, int incr, s
 	return (currentIndex + incr + endIndex) % endIndex;
 }
 
+static inline uint8_t utils_popcount64(uint64_t value) {
+	return (uint8_t)__builtin_popcountll(value);
+}
+
+// value must not be 0
+static inline uint8_t utils_lowestBit64(uint64_t value) {
+	return (uint8_t)__builtin_ctzll(value);
+}
+
+// value must not be 0
+static inline uint8_t utils_highestBit64(uint64_t value) {
+	return (uint8_t)(63 - __builtin_clzll(value));
+}
+
 #endif /* utils_h */